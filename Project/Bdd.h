@@ -0,0 +1,384 @@
+#pragma once
+
+// C++ system includes
+#include <cstdint>
+#include <functional>
+
+// Own includes
+#include "Program.h"
+#include "Utils.h"
+
+// Съдържа редуцираната наредена двоична диаграма на решенията (ROBDD) на логическа функция. Чрез нея
+// се сравняват схеми, броят се удовлетворяващите входове и се принтира функцията без да се изброяват
+// всички 2^n входа
+
+// Възлите 0 и 1 са константите
+static constexpr auto BDD_FALSE = 0;
+static constexpr auto BDD_TRUE = 1;
+// Връща се вместо възел, когато диаграмата надхвърли BDD_MAX_NODES
+static constexpr auto BDD_OVERFLOW = -1;
+// Максимален брой възли на диаграмата
+static constexpr auto BDD_MAX_NODES = 1 << 24;
+// Брой клетки в кеша на пресметнатите операции (степен на 2)
+static constexpr auto BDD_CACHE_SIZE = 1 << 18;
+
+// Наредби на променливите - по реда на аргументите, обратна и по реда на първото им използване в
+// компилираната програма (свързаните аргументи остават близо един до друг)
+static constexpr auto BDD_ORDER_NATURAL = 0;
+static constexpr auto BDD_ORDER_REVERSE = 1;
+static constexpr auto BDD_ORDER_APPEARANCE = 2;
+
+// Възел от диаграмата. Наследниците се добавят преди възела, затова индексите са топологично подредени
+struct BddNode {
+    int level = 0;  // Позицията на променливата в наредбата (за константите е броят променливи)
+    int low = -1;   // Наследникът при стойност 0 на променливата
+    int high = -1;  // Наследникът при стойност 1 на променливата
+};
+
+// Клетка от кеша на пресметнатите операции
+struct BddCacheEntry {
+    char op = 0;
+    int left = -1;
+    int right = -1;
+    int result = -1;
+};
+
+// Диаграма с уникална таблица - всеки възел (level, low, high) съществува само веднъж, затова две
+// функции над една диаграма са еквивалентни точно когато корените им съвпадат
+struct Bdd {
+    BddNode* nodes = nullptr;
+    int size = 0;
+    int capacity = 0;
+    int* table = nullptr;   // Уникалната таблица с индексите на възлите (-1 е празна клетка)
+    int tableCapacity = 0;  // Винаги е степен на 2
+    BddCacheEntry* cache = nullptr;
+    int varCount = 0;
+    int* order = nullptr;    // order[level] е аргументът на съответното ниво
+    int* levelOf = nullptr;  // levelOf[arg] е нивото на аргумента
+};
+
+namespace utils {
+// Пресмята хеш на възел от диаграмата
+std::uint64_t hashBddNode(const int level, const int low, const int high) {
+    std::uint64_t hash = (std::uint32_t)level;
+    hash = hash * 0x9E3779B97F4A7C15ULL + (std::uint32_t)low;
+    hash = hash * 0x9E3779B97F4A7C15ULL + (std::uint32_t)high;
+    return hash ^ (hash >> 29);
+}
+
+// Попълва наредбата на аргументите (order[level] е аргументът на съответното ниво)
+void fillBddOrder(const Program& program, const int argCount, const int orderKind, int* order) {
+    if (orderKind == BDD_ORDER_APPEARANCE) {
+        bool* seen = new bool[argCount + 1]{};
+        int level = 0;
+        for (int i = 0; i < program.size; i++) {
+            const Instruction& instr = program.code[i];
+            if (instr.op == OP_LOAD && instr.slot < argCount && !seen[instr.slot]) {
+                seen[instr.slot] = true;
+                order[level++] = instr.slot;
+            }
+        }
+        // Аргументите, които не се използват, са най-отдолу
+        for (int arg = 0; arg < argCount; arg++) {
+            if (!seen[arg]) {
+                order[level++] = arg;
+            }
+        }
+        delete[] seen;
+        return;
+    }
+    for (int level = 0; level < argCount; level++) {
+        order[level] = orderKind == BDD_ORDER_REVERSE ? argCount - 1 - level : level;
+    }
+}
+}  // namespace utils
+
+// Прави нова диаграма с дадената наредба на аргументите
+Bdd makeBdd(const int* order, const int varCount) {
+    Bdd bdd;
+    bdd.capacity = 1024;
+    bdd.nodes = new BddNode[bdd.capacity];
+    bdd.tableCapacity = 2048;
+    bdd.table = utils::allocIntArray(bdd.tableCapacity);
+    for (int i = 0; i < bdd.tableCapacity; i++) {
+        bdd.table[i] = -1;
+    }
+    bdd.cache = new BddCacheEntry[BDD_CACHE_SIZE];
+    bdd.varCount = varCount;
+    bdd.order = utils::allocIntArray(varCount + 1);
+    bdd.levelOf = utils::allocIntArray(varCount + 1);
+    for (int level = 0; level < varCount; level++) {
+        bdd.order[level] = order[level];
+        bdd.levelOf[order[level]] = level;
+    }
+    // Константите са под всички променливи
+    bdd.nodes[BDD_FALSE] = {varCount, BDD_FALSE, BDD_FALSE};
+    bdd.nodes[BDD_TRUE] = {varCount, BDD_TRUE, BDD_TRUE};
+    bdd.size = 2;
+    return bdd;
+}
+
+// Освобождава паметта на дадената диаграма
+void freeBdd(Bdd& bdd) {
+    delete[] bdd.nodes;
+    bdd.nodes = nullptr;
+    bdd.capacity = 0;
+    bdd.size = 0;
+    utils::freeIntArray(bdd.table);
+    bdd.tableCapacity = 0;
+    delete[] bdd.cache;
+    bdd.cache = nullptr;
+    utils::freeIntArray(bdd.order);
+    utils::freeIntArray(bdd.levelOf);
+    bdd.varCount = 0;
+}
+
+// Намира клетката в уникалната таблица, в която е (или трябва да бъде) дадения възел
+int findBddSlot(const Bdd& bdd, const int level, const int low, const int high) {
+    const int mask = bdd.tableCapacity - 1;
+    int slot = (int)(utils::hashBddNode(level, low, high) & mask);
+    while (bdd.table[slot] != -1) {
+        const BddNode& node = bdd.nodes[bdd.table[slot]];
+        if (node.level == level && node.low == low && node.high == high) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Връща индекса на възела (level, low, high), като го добавя, ако все още не съществува. Възел с
+// еднакви наследници се съкращава до наследника си
+int addBddNode(Bdd& bdd, const int level, const int low, const int high) {
+    if (low == BDD_OVERFLOW || high == BDD_OVERFLOW) {
+        return BDD_OVERFLOW;
+    }
+    if (low == high) {
+        return low;
+    }
+    int slot = findBddSlot(bdd, level, low, high);
+    if (bdd.table[slot] != -1) {
+        return bdd.table[slot];
+    }
+    if (bdd.size == BDD_MAX_NODES) {
+        return BDD_OVERFLOW;
+    }
+
+    if (bdd.size == bdd.capacity) {
+        const int newCapacity = bdd.capacity * 2;
+        BddNode* newNodes = new BddNode[newCapacity];
+        for (int i = 0; i < bdd.size; i++) {
+            newNodes[i] = bdd.nodes[i];
+        }
+        delete[] bdd.nodes;
+        bdd.nodes = newNodes;
+        bdd.capacity = newCapacity;
+    }
+    if ((bdd.size + 1) * 2 > bdd.tableCapacity) {
+        utils::freeIntArray(bdd.table);
+        bdd.tableCapacity *= 2;
+        bdd.table = utils::allocIntArray(bdd.tableCapacity);
+        for (int i = 0; i < bdd.tableCapacity; i++) {
+            bdd.table[i] = -1;
+        }
+        for (int i = 2; i < bdd.size; i++) {
+            const BddNode& node = bdd.nodes[i];
+            bdd.table[findBddSlot(bdd, node.level, node.low, node.high)] = i;
+        }
+        slot = findBddSlot(bdd, level, low, high);
+    }
+
+    bdd.nodes[bdd.size] = {level, low, high};
+    bdd.table[slot] = bdd.size;
+    return bdd.size++;
+}
+
+// Връща възела на даден аргумент
+int makeBddVar(Bdd& bdd, const int arg) {
+    return addBddNode(bdd, bdd.levelOf[arg], BDD_FALSE, BDD_TRUE);
+}
+
+// Прилага логическа операция ('!', '&', '|' или '^') над възлите a и b (b не се използва при '!')
+int applyBdd(Bdd& bdd, const char op, int a, int b) {
+    if (a == BDD_OVERFLOW || (op != '!' && b == BDD_OVERFLOW)) {
+        return BDD_OVERFLOW;
+    }
+    // Тривиалните случаи
+    switch (op) {
+    case '!':
+        if (a == BDD_FALSE || a == BDD_TRUE) {
+            return !a;
+        }
+        b = -1;
+        break;
+    case '&':
+        if (a == BDD_FALSE || b == BDD_FALSE) {
+            return BDD_FALSE;
+        }
+        if (a == BDD_TRUE) {
+            return b;
+        }
+        if (b == BDD_TRUE || a == b) {
+            return a;
+        }
+        break;
+    case '|':
+        if (a == BDD_TRUE || b == BDD_TRUE) {
+            return BDD_TRUE;
+        }
+        if (a == BDD_FALSE) {
+            return b;
+        }
+        if (b == BDD_FALSE || a == b) {
+            return a;
+        }
+        break;
+    default:
+        if (a == b) {
+            return BDD_FALSE;
+        }
+        if (a == BDD_FALSE) {
+            return b;
+        }
+        if (b == BDD_FALSE) {
+            return a;
+        }
+        if (a == BDD_TRUE || b == BDD_TRUE) {
+            return applyBdd(bdd, '!', a == BDD_TRUE ? b : a, -1);
+        }
+    }
+    // Операторите са комутативни, затова подреждаме операндите
+    if (op != '!' && a > b) {
+        const int tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    BddCacheEntry& entry =
+        bdd.cache[utils::hashBddNode(op, a, b) & (BDD_CACHE_SIZE - 1)];
+    if (entry.op == op && entry.left == a && entry.right == b) {
+        return entry.result;
+    }
+
+    // Разделяме по най-горната от двете променливи (възлите се копират, защото масивът може да расте)
+    const BddNode nodeA = bdd.nodes[a];
+    const BddNode nodeB = op == '!' ? nodeA : bdd.nodes[b];
+    const int level = nodeA.level < nodeB.level ? nodeA.level : nodeB.level;
+    const int aLow = nodeA.level == level ? nodeA.low : a;
+    const int aHigh = nodeA.level == level ? nodeA.high : a;
+    const int bLow = op != '!' && nodeB.level == level ? nodeB.low : b;
+    const int bHigh = op != '!' && nodeB.level == level ? nodeB.high : b;
+    const int low = applyBdd(bdd, op, aLow, bLow);
+    const int high = applyBdd(bdd, op, aHigh, bHigh);
+    const int result = addBddNode(bdd, level, low, high);
+
+    // Клетката може да е презаписана при рекурсията, затова я търсим отново
+    BddCacheEntry& slot = bdd.cache[utils::hashBddNode(op, a, b) & (BDD_CACHE_SIZE - 1)];
+    slot = {op, a, b, result};
+    return result;
+}
+
+// Изпълнява програмата символно и строи диаграмата на израза й. Връща корена на изход 0 или
+// BDD_OVERFLOW, а ако outputs не е nullptr, записва в него корените на всички изходи
+int buildBdd(Bdd& bdd, const Program& program, const int argCount, int* outputs = nullptr) {
+    int* registers = utils::allocIntArray(program.registerCount + 1);
+    int* stack = utils::allocIntArray(program.size + 1);
+    int top = -1;
+    for (int slot = 0; slot < argCount; slot++) {
+        registers[slot] = makeBddVar(bdd, slot);
+    }
+    for (int i = 0; i < program.size; i++) {
+        const Instruction& instr = program.code[i];
+        switch (instr.op) {
+        case OP_LOAD:
+            stack[++top] = registers[instr.slot];
+            break;
+        case OP_STORE:
+            registers[instr.slot] = stack[top--];
+            break;
+        case OP_CONST:
+            stack[++top] = instr.slot ? BDD_TRUE : BDD_FALSE;
+            break;
+        case '!':
+            stack[top] = applyBdd(bdd, '!', stack[top], -1);
+            break;
+        default:
+            stack[top - 1] = applyBdd(bdd, instr.op, stack[top - 1], stack[top]);
+            top--;
+        }
+    }
+    assert(top == 0 && "Something is wrong");
+    const int root = stack[0];
+    for (int i = 0; outputs && i < program.outputCount; i++) {
+        outputs[i] = i == 0 ? root : registers[argCount + i];
+    }
+    // Освобождаваме паметта
+    utils::freeIntArray(registers);
+    utils::freeIntArray(stack);
+    return root;
+}
+
+// Брои входовете, на които функцията с даден корен е 1. Броят е точен до 2^64
+long double countBddModels(const Bdd& bdd, const int root) {
+    // counts[i] е броят удовлетворяващи присвоявания на променливите от нивото на възел i надолу
+    long double* counts = new long double[root + 1];
+    const auto scaled = [&](const int child, const int level) {
+        long double count = counts[child];
+        for (int l = level + 1; l < bdd.nodes[child].level; l++) {
+            count *= 2;
+        }
+        return count;
+    };
+    for (int i = 0; i <= root; i++) {
+        const BddNode& node = bdd.nodes[i];
+        if (i == BDD_FALSE || i == BDD_TRUE) {
+            counts[i] = i;
+        } else {
+            counts[i] = scaled(node.low, node.level) + scaled(node.high, node.level);
+        }
+    }
+    long double count = counts[root];
+    for (int l = 0; l < bdd.nodes[root].level; l++) {
+        count *= 2;
+    }
+    delete[] counts;
+    return count;
+}
+
+// Обхожда всички пътища до константата 1. За всеки път извиква visit със стойностите на аргументите
+// (-1 за аргументите, от които резултатът не зависи)
+void visitBddCubes(const Bdd& bdd, const int node, int* values,
+                   const std::function<void(const int*)>& visit) {
+    if (node == BDD_FALSE) {
+        return;
+    }
+    if (node == BDD_TRUE) {
+        visit(values);
+        return;
+    }
+    const BddNode& current = bdd.nodes[node];
+    const int arg = bdd.order[current.level];
+    values[arg] = 0;
+    visitBddCubes(bdd, current.low, values, visit);
+    values[arg] = 1;
+    visitBddCubes(bdd, current.high, values, visit);
+    values[arg] = -1;
+}
+
+// Намира един вход, на който функцията с даден корен е 1 (аргументите, от които резултатът не зависи,
+// са 0). Връща false, ако функцията е константа 0
+bool findBddModel(const Bdd& bdd, const int root, int* values) {
+    for (int arg = 0; arg < bdd.varCount; arg++) {
+        values[arg] = 0;
+    }
+    if (root == BDD_FALSE) {
+        return false;
+    }
+    for (int node = root; node != BDD_TRUE;) {
+        const BddNode& current = bdd.nodes[node];
+        const int arg = bdd.order[current.level];
+        values[arg] = current.low == BDD_FALSE ? 1 : 0;
+        node = current.low == BDD_FALSE ? current.high : current.low;
+    }
+    return true;
+}
@@ -0,0 +1,291 @@
+// C++ system includes
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <sstream>
+#include <string>
+
+// POSIX includes
+#include <unistd.h>
+
+// Own includes
+#include "Circuit.h"
+
+// Бенчмарк на отделните етапи на симулатора (парсване и компилация на ис, изпълнение на един вход
+// с интерпретатора, побитово паралелно изпълнение, ALL, парсване на таблица на истинност и FIND)
+// върху генерирани ис с нарастващ размер и дълбочина.
+// За всеки етап принтира времето за едно извикване, обработените редове в секунда и броя заделяния
+// на памет за едно извикване
+
+// Минимално време за измерване на един етап (извикванията се повтарят, докато не се достигне)
+static constexpr double BENCH_MIN_SECONDS = 0.2;
+// Начално число на генератора на изразите и таблиците (за възпроизводими резултати)
+static constexpr std::uint64_t BENCH_SEED = 2024;
+// Брой предварително генерирани входни вектора, които етапът runCircuit изпълнява поред
+static constexpr auto BENCH_INPUT_VECTORS = 256;
+
+// Брой заделяния на памет от началото на програмата
+static std::atomic<std::uint64_t> allocationCount{0};
+
+// Заделя памет с malloc и я отброява
+static void* countedAlloc(const std::size_t size) noexcept {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size > 0 ? size : 1);
+}
+
+// Заменяме глобалните оператори за заделяне на памет, за да броим заделянията. Основните оператори
+// не се вграждат, за да не вижда компилаторът malloc от едната страна и delete от другата
+[[gnu::noinline]] void* operator new(std::size_t size) {
+    void* ptr = countedAlloc(size);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+[[gnu::noinline]] void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+[[gnu::noinline]] void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+// Вариантите за масиви и с размер се свеждат до горните, за да остане всяко new в двойка със
+// съответното си delete
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { operator delete[](ptr); }
+
+// Буфер, който изхвърля всичко записано в него (за изхода на ALL по време на измерването)
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int ch) override { return ch; }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+// Резултат от измерването на един етап
+struct BenchResult {
+    std::uint64_t calls = 0;
+    double nsPerCall = 0;
+    double allocsPerCall = 0;
+};
+
+// Размер на генерирана ис
+struct BenchSize {
+    int inputs = 0;
+    int depth = 0;
+};
+
+namespace utils {
+// Генерира случаен логически израз с дадена дълбочина над първите argCount входа
+std::string generateExpression(RandomGenerator& generator, const int argCount, const int depth) {
+    const std::uint64_t choice = nextRandomWord(generator);
+    if (depth == 0) {
+        return getArgumentName((int)(choice % argCount));
+    }
+    std::string left = generateExpression(generator, argCount, depth - 1);
+    // Отрицанията са рядко, за да остане дълбочината на израза depth
+    if ((choice >> 32) % 8 == 0) {
+        left = "!" + left;
+    }
+    const std::string right = generateExpression(generator, argCount, depth - 1);
+    return "(" + left + ((choice >> 40) & 1 ? " & " : " | ") + right + ")";
+}
+
+// Записва пълна таблица на истинност със случаен изход за дадения брой входове
+bool writeTruthTable(RandomGenerator& generator, const int inputCount, const char* fileName) {
+    std::FILE* file = std::fopen(fileName, "wb");
+    if (!file) {
+        return false;
+    }
+    std::string line;
+    for (std::uint64_t row = 0; row < (1ULL << inputCount); row++) {
+        line.clear();
+        for (int i = inputCount - 1; i >= 0; i--) {
+            line += (char)('0' + ((row >> i) & 1));
+            line += ' ';
+        }
+        line += (char)('0' + (nextRandomWord(generator) & 1));
+        line += '\n';
+        std::fwrite(line.data(), 1, line.size(), file);
+    }
+    return std::fclose(file) == 0;
+}
+}  // namespace utils
+
+// Извиква body, докато не изминат поне BENCH_MIN_SECONDS, и връща средното време и средния брой
+// заделяния на памет за едно извикване (първото извикване е загряване и не се брои)
+BenchResult measureStage(const std::function<void()>& body) {
+    body();
+    BenchResult result;
+    const std::uint64_t allocationsBefore = allocationCount.load();
+    const auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed{0};
+    for (std::uint64_t batch = 1; elapsed.count() < BENCH_MIN_SECONDS; batch *= 2) {
+        for (std::uint64_t i = 0; i < batch; i++) {
+            body();
+        }
+        result.calls += batch;
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    result.nsPerCall = elapsed.count() * 1e9 / (double)result.calls;
+    result.allocsPerCall =
+        (double)(allocationCount.load() - allocationsBefore) / (double)result.calls;
+    return result;
+}
+
+// Принтира реда с резултата за един етап. rowsPerCall е броят обработени редове на извикване (0,
+// ако етапът не обработва редове)
+void printResult(const char* stage, const std::string& size, const BenchResult& result,
+                 const double rowsPerCall) {
+    char rows[32] = "-";
+    if (rowsPerCall > 0) {
+        std::snprintf(rows, sizeof(rows), "%.3e", rowsPerCall * 1e9 / result.nsPerCall);
+    }
+    std::printf("%-24s %-18s %10llu %14.1f %12s %12.1f\n", stage, size.c_str(),
+                (unsigned long long)result.calls, result.nsPerCall, rows, result.allocsPerCall);
+    std::fflush(stdout);
+}
+
+// Измерва етапите с израза на ис с даден размер
+void benchCircuit(RandomGenerator& generator, const BenchSize& size) {
+    const std::string expr = utils::generateExpression(generator, size.inputs, size.depth);
+    const std::string sizeName =
+        std::to_string(size.inputs) + " in, depth " + std::to_string(size.depth);
+    std::string args;
+    for (int i = 0; i < size.inputs; i++) {
+        args += (i > 0 ? ", " : "") + utils::getArgumentName(i);
+    }
+    const std::string definition = "f(" + args + "): \"" + expr + "\"";
+
+    printResult("tokenizeExpression", sizeName, measureStage([&]() {
+                    StringVector tokens = makeStringVector(100);
+                    utils::tokenizeExpression(tokens, expr);
+                    clearStringVector(tokens);
+                }),
+                0);
+
+    CircuitStorage storage = makeCircuitStorage(INITIAL_CIRCUITS_CAPACITY);
+    printResult("parseIntegratedCircuit", sizeName, measureStage([&]() {
+                    std::istringstream istream(definition);
+                    IntegratedCircuit circuit = parseIntegratedCircuit(istream, storage);
+                    freeIntegratedCircuit(circuit);
+                }),
+                0);
+
+    std::istringstream istream(definition);
+    IntegratedCircuit circuit = parseIntegratedCircuit(istream, storage);
+    printResult("compileCircuit", sizeName,
+                measureStage([&]() { compileCircuit(circuit, storage); }), 0);
+
+    // Всяко извикване изпълнява следващия от предварително генерираните входове
+    CircuitInput* inputs = new CircuitInput[BENCH_INPUT_VECTORS];
+    for (int v = 0; v < BENCH_INPUT_VECTORS; v++) {
+        inputs[v] = makeCircuitInput();
+        for (int i = 0; i < size.inputs; i++) {
+            pushToIntVector(inputs[v].args, (int)(utils::nextRandomWord(generator) & 1));
+        }
+    }
+    int nextInput = 0;
+    printResult("runCircuit", sizeName, measureStage([&]() {
+                    volatile int res = runCircuit(circuit, inputs[nextInput]);
+                    (void)res;
+                    nextInput = (nextInput + 1) % BENCH_INPUT_VECTORS;
+                }),
+                1);
+
+    const int words = slicedBackend.words;
+    std::uint64_t* argMasks = utils::allocWordArray(circuit.program.registerCount * words);
+    std::uint64_t* stack = utils::allocWordArray(circuit.program.maxDepth * words);
+    std::uint64_t* res = utils::allocWordArray(circuit.program.outputCount * words);
+    for (int i = 0; i < size.inputs * words; i++) {
+        argMasks[i] = utils::nextRandomWord(generator);
+    }
+    printResult("executeCircuitSliced", sizeName,
+                measureStage([&]() { executeCircuitSliced(circuit, argMasks, stack, res); }),
+                (double)words * ROWS_PER_WORD);
+
+    NullBuffer nullBuffer;
+    std::streambuf* coutBuffer = std::cout.rdbuf(&nullBuffer);
+    const BenchResult allResult = measureStage([&]() { runAllCommand(circuit, 1); });
+    std::cout.rdbuf(coutBuffer);
+    printResult("runAllCommand", sizeName, allResult, (double)(1ULL << size.inputs));
+    // Освобождаваме паметта
+    for (int v = 0; v < BENCH_INPUT_VECTORS; v++) {
+        freeCircuitInput(inputs[v]);
+    }
+    delete[] inputs;
+    utils::freeWordArray(argMasks);
+    utils::freeWordArray(stack);
+    utils::freeWordArray(res);
+    freeIntegratedCircuit(circuit);
+    freeCircuitStorage(storage);
+}
+
+// Измерва парсването на таблица на истинност и FIND с даден брой входове. Таблицата се записва
+// във временния файл fileName
+void benchTruthTable(RandomGenerator& generator, const int inputCount, const char* fileName) {
+    if (!utils::writeTruthTable(generator, inputCount, fileName)) {
+        std::cerr << "Failed to write truth table to " << fileName << ".\n";
+        return;
+    }
+    const std::string sizeName = std::to_string(inputCount) + " in";
+    const double rows = (double)(1ULL << inputCount);
+
+    printResult("parseTruthTable", sizeName, measureStage([&]() {
+                    TruthTable table = parseTruthTable(fileName, 1);
+                    freeTruthTable(table);
+                }),
+                rows);
+
+    TruthTable table = parseTruthTable(fileName, 1);
+    printResult("runFindCommand", sizeName, measureStage([&]() {
+                    volatile std::size_t length = runFindCommand(table, 0).size();
+                    (void)length;
+                }),
+                rows);
+    // Освобождаваме паметта
+    freeTruthTable(table);
+}
+
+int main(int argc, char* argv[]) {
+    // С --quick се измерват само малките размери
+    const bool quick = argc > 1 && std::string(argv[1]) == "--quick";
+    if (argc > 2 || (argc == 2 && !quick)) {
+        std::cerr << "Usage: " << argv[0] << " [--quick]\n";
+        return 1;
+    }
+
+    const BenchSize circuitSizes[] = {{4, 4}, {8, 8}, {12, 10}, {16, 12}, {20, 14}};
+    const int tableSizes[] = {8, 12, 16, 18};
+    const int circuitSizeCount = quick ? 2 : (int)(sizeof(circuitSizes) / sizeof(BenchSize));
+    const int tableSizeCount = quick ? 2 : (int)(sizeof(tableSizes) / sizeof(int));
+
+    std::printf("Kernel: %s\n", slicedBackend.name);
+    std::printf("%-24s %-18s %10s %14s %12s %12s\n", "stage", "size", "calls", "ns/call",
+                "rows/s", "allocs/call");
+    RandomGenerator generator = makeRandomGenerator(BENCH_SEED);
+    for (int i = 0; i < circuitSizeCount; i++) {
+        benchCircuit(generator, circuitSizes[i]);
+    }
+
+    // Таблиците се записват в уникален временен файл (в TMPDIR, ако е зададена)
+    const char* tmpDir = std::getenv("TMPDIR");
+    std::string tablePath = tmpDir && *tmpDir ? tmpDir : "/tmp";
+    tablePath += "/circuit_bench_XXXXXX";
+    const int tableFd = mkstemp(tablePath.data());
+    if (tableFd == -1) {
+        std::cerr << "Failed to create a temporary file for the truth tables.\n";
+        return 1;
+    }
+    close(tableFd);
+    for (int i = 0; i < tableSizeCount; i++) {
+        benchTruthTable(generator, tableSizes[i], tablePath.c_str());
+    }
+    std::remove(tablePath.c_str());
+    return 0;
+}
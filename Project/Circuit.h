@@ -0,0 +1,2161 @@
+#pragma once
+
+// C++ system includes
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+// POSIX includes
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Own includes
+#include "Bdd.h"
+#include "Dag.h"
+#include "Jit.h"
+#include "Minimize.h"
+#include "Program.h"
+#include "RunCache.h"
+#include "Stats.h"
+#include "Utils.h"
+
+// Съдържа интегралните схеми, хранилището им и изпълнението на командите на симулатора
+
+// Начален капацитет на хранилището за ис (то расте при нужда)
+static constexpr auto INITIAL_CIRCUITS_CAPACITY = 100;
+
+// Брой редове от таблицата на истинност (или случайни вектори при RANDOM), които една нишка
+// пресмята наведнъж при ALL (кратно на размера на блока на всяко от ядрата)
+static constexpr std::uint64_t ROWS_PER_THREAD_CHUNK = 1 << 16;
+// Най-много колко нишки на ядро на процесора може да се зададат с -j N и ALL name THREADS n
+static constexpr auto MAX_THREADS_PER_CORE = 4;
+
+// Размер на буферите за четене и запис при RUNFILE
+static constexpr auto IO_BUFFER_SIZE = 1 << 20;
+// Размер на алокатора за временните вектори на една команда (входовете на RUN)
+static constexpr std::size_t COMMAND_ARENA_SIZE = 1 << 16;
+// Идентификатор и версия на формата на библиотеките от ис (версията се сменя при промяна на формата,
+// на инструкциите или на хеша на имената)
+static constexpr char LIBRARY_MAGIC[4] = {'I', 'C', 'L', 'B'};
+static constexpr std::uint32_t LIBRARY_VERSION = 3;
+// До колко входа EQUIV сравнява схемите чрез изброяване на всички входове (иначе чрез диаграма)
+static constexpr auto EQUIV_EXHAUSTIVE_MAX_INPUTS = 24;
+
+// Съдържа данните на интегрална схема
+struct IntegratedCircuit {
+    std::string name = "";
+    std::string expr = "";
+    StringVector tokenizedExpr;
+    StringVector arguments;
+    StringVector outputs;  // Имената на изходите (празно при един изход без име)
+    Program program;       // Компилира се веднъж при DEFINE - всички изходи в обща програма
+    std::uint64_t nameHash = 0;  // Предварително пресметнат хеш на името
+    NativeModule native;         // Нативният код на програмата след COMPILE
+    // Регистърът на последователна ис - входът, в който изход 0 се връща на следващия такт
+    // (-1 за комбинационна ис). Извън SIM регистърът е обикновен вход
+    int feedbackSlot = -1;
+    RunCache runCache;  // Резултатите от RUN (и от ALL при малко входове)
+};
+
+// Съдържа аргументите за вход на интегрална схема
+struct CircuitInput {
+    std::string circuitName = "";  // Таргетната ис
+    IntVector args;
+};
+
+// Пази всички интегрални схеми в програмата
+struct CircuitStorage {
+    IntegratedCircuit* circuits = nullptr;
+    int size = 0;
+    int capacity = 0;
+    // Хеш таблица с отворено адресиране, която пази индексите на ис по име (-1 е празна клетка)
+    int* index = nullptr;
+    int indexCapacity = 0;  // Винаги е степен на 2
+};
+
+// Заглавие на двоичния файл с библиотека от компилирани ис. След него са записите на схемите,
+// инструкциите на всички програми (във вида, в който са в паметта) и низовете им
+struct LibraryHeader {
+    char magic[4] = {};
+    std::uint32_t version = 0;
+    std::uint32_t circuitCount = 0;
+    std::uint32_t instructionSize = 0;  // sizeof(Instruction) при записа на файла
+    std::uint64_t entriesOffset = 0;
+    std::uint64_t codeOffset = 0;
+    std::uint64_t stringsOffset = 0;
+    std::uint64_t fileSize = 0;
+};
+
+// Запис на една ис в библиотеката. Отместванията на низовете са спрямо началото на низовете, а на
+// програмата - брой инструкции спрямо началото на инструкциите
+struct LibraryEntry {
+    std::uint64_t nameHash = 0;
+    std::uint64_t nameOffset = 0;
+    std::uint64_t exprOffset = 0;
+    std::uint64_t argsOffset = 0;  // Имената на аргументите едно след друго, всяко завършва с '\0'
+    std::uint64_t outputsOffset = 0;  // Имената на изходите във вида на аргументите
+    std::uint64_t codeOffset = 0;
+    std::uint32_t nameLength = 0;
+    std::uint32_t exprLength = 0;
+    std::uint32_t argsLength = 0;
+    std::uint32_t argCount = 0;
+    std::uint32_t outputsLength = 0;
+    std::uint32_t outputNameCount = 0;
+    std::uint32_t outputCount = 0;
+    std::uint32_t codeSize = 0;
+    std::uint32_t registerCount = 0;
+    std::int32_t feedbackSlot = -1;
+};
+
+// Входни потоци за SIM. Всеки поток (лента) съдържа стойностите на входовете на ис за steps
+// последователни такта, които се повтарят, ако тактовете са повече. Потоците се пазят побитово по
+// 64 в дума - стойността на вход i на такт step за група g е в
+// words[(g * steps + step) * inputCount + i]
+struct Stimulus {
+    std::uint64_t* words = nullptr;
+    int lanes = 0;
+    int steps = 0;
+    int inputCount = 0;
+    int capacity = 0;  // Брой заделени думи
+};
+
+// Статистика за изходите на ис при изпълнение със случайни вектори (RANDOM)
+struct RandomStats {
+    std::uint64_t vectors = 0;
+    std::uint64_t* ones = nullptr;       // Брой вектори с резултат 1 на всеки изход
+    std::uint64_t* sensitive = nullptr;  // Брой вектори, при които смяната на входа променя изход
+};
+
+namespace utils {
+// Връща най-големия допустим брой нишки (ако броят ядра е неизвестен, се приема за 1)
+int getMaxThreadCount() {
+    const unsigned int cores = std::thread::hardware_concurrency();
+    return (int)(cores > 0 ? cores : 1) * MAX_THREADS_PER_CORE;
+}
+
+// Пресмята хеш на име на ис (FNV-1a)
+std::uint64_t hashName(const std::string& name) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (const auto ch : name) {
+        hash ^= (unsigned char)ch;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Парсва име на файл, оградено в кавички (останалата част от реда не се консумира)
+std::string getFileName(std::istream& istream) {
+    std::string fileName;
+    istream >> std::ws;
+    if (istream.peek() == '\"') {
+        istream.get();
+        std::getline(istream, fileName, '\"');
+    } else {
+        istream >> fileName;
+    }
+    return fileName;
+}
+
+// Принтира данните за дадена ис
+void printCircuit(const IntegratedCircuit& circuit) {
+    const int argSize = circuit.arguments.size;
+    std::cout << circuit.name << "(";
+    for (int i = 0; i < argSize - 1; i++) {
+        std::cout << circuit.arguments.data[i] << ", ";
+    }
+    std::cout << circuit.arguments.data[argSize - 1] << ") ";
+    for (int i = 0; i < circuit.outputs.size; i++) {
+        std::cout << (i == 0 ? "-> " : ", ") << circuit.outputs.data[i];
+    }
+    std::cout << (circuit.outputs.size > 0 ? " " : "") << circuit.expr;
+    if (circuit.feedbackSlot != -1) {
+        std::cout << " REG " << circuit.arguments.data[circuit.feedbackSlot];
+    }
+    std::cout << "\n";
+}
+
+// Проверява дали символът може да бъде част от име на вход или ис
+bool isNameChar(const char ch) { return std::isalnum((unsigned char)ch) || ch == '_'; }
+
+// Връща името на i-тия вход на синтезирана ис (a, b, ..., z, x26, x27, ...)
+std::string getArgumentName(const int i) {
+    return i < 26 ? std::string(1, (char)('a' + i)) : "x" + std::to_string(i);
+}
+
+// Проверява дали токенът е име (на вход или на ис)
+bool isIdentifier(const std::string& token) {
+    if (token.empty()) {
+        return false;
+    }
+    for (const auto ch : token) {
+        if (!isNameChar(ch)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Проверява дали от позиция pos в токените започва извикване на ис от вида name(...)
+bool isCircuitCall(const StringVector& tokens, const int pos) {
+    return isIdentifier(tokens.data[pos]) && pos + 1 < tokens.size && tokens.data[pos + 1] == "(";
+}
+
+// Връща индекса на входа на ис с даденото име или -1, ако няма такъв
+int findArgumentSlot(const IntegratedCircuit& circuit, const std::string& name) {
+    for (int slot = 0; slot < circuit.arguments.size; slot++) {
+        if (circuit.arguments.data[slot] == name) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+// Връща индекса на изхода на ис с даденото име или -1, ако няма такъв
+int findOutputIndex(const IntegratedCircuit& circuit, const std::string& name) {
+    for (int i = 0; i < circuit.outputs.size; i++) {
+        if (circuit.outputs.data[i] == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Проверява дали входовете на ис са същите като тези които се използват в логическия израз
+bool validateCircuit(const IntegratedCircuit& circuit) {
+    for (int i = 0; i < circuit.tokenizedExpr.size; i++) {
+        const auto& token = circuit.tokenizedExpr.data[i];
+        if (token == "&" || token == "|" || token == "!" || token == "(" || token == ")" ||
+            token == ",") {
+            continue;
+        }
+        // Имената на извикани подсхеми се проверяват при компилацията
+        if (isCircuitCall(circuit.tokenizedExpr, i)) {
+            continue;
+        }
+        if (findArgumentSlot(circuit, token) == -1 && token != "0" && token != "1") {
+            std::cerr << "Found token {" << token << "} that is not valid operator or operand.\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Превръща входен израз на ис в токени - оператори, скоби, запетаи и имена от букви, цифри и '_'
+void tokenizeExpression(StringVector& tokens, const std::string& expr) {
+    for (std::size_t i = 0; i < expr.size(); i++) {
+        const char ch = expr[i];
+        if (std::isspace((unsigned char)ch) || ch == '\"') {
+            continue;
+        }
+        std::size_t end = i + 1;
+        if (isNameChar(ch)) {
+            while (end < expr.size() && isNameChar(expr[end])) {
+                end++;
+            }
+        }
+        pushToStringVector(tokens, expr.substr(i, end - i));
+        i = end - 1;
+    }
+}
+
+// Връща предходността на логическите оператори
+int getPrecedence(const char op) {
+    switch (op) {
+    case '!':
+        return 3;
+    case '&':
+        return 2;
+    case '|':
+        return 1;
+    default:
+        std::cerr << "Unknown operator found: " << op << '\n';
+    }
+    return -1;
+}
+
+// Проверява дали токенът е логически оператор
+bool isOperator(const char token) { return token == '!' || token == '&' || token == '|'; }
+}  // namespace utils
+
+// Прави нова ис
+IntegratedCircuit makeIntegratedCircuit() {
+    IntegratedCircuit circuit;
+    circuit.tokenizedExpr = makeStringVector(100);
+    circuit.arguments = makeStringVector(16);
+    circuit.outputs = makeStringVector(4);
+    return circuit;
+}
+
+// Освобождава паметта на дадената ис
+void freeIntegratedCircuit(IntegratedCircuit& circuit) {
+    clearStringVector(circuit.tokenizedExpr);
+    clearStringVector(circuit.arguments);
+    clearStringVector(circuit.outputs);
+    freeProgram(circuit.program);
+    freeNativeModule(circuit.native);
+    freeRunCache(circuit.runCache);
+    circuit.name = "";
+    circuit.expr = "";
+    circuit.feedbackSlot = -1;
+}
+
+// Прави празни входни потоци за ис с дадения брой входове (без регистъра)
+Stimulus makeStimulus(const int inputCount) {
+    Stimulus stimulus;
+    stimulus.inputCount = inputCount;
+    return stimulus;
+}
+
+// Освобождава паметта на дадените входни потоци
+void freeStimulus(Stimulus& stimulus) {
+    utils::freeWordArray(stimulus.words);
+    stimulus.capacity = 0;
+    stimulus.lanes = 0;
+    stimulus.steps = 0;
+}
+
+// Добавя поток от steps * inputCount стойности (0 или 1), подредени по тактове
+void pushToStimulus(Stimulus& stimulus, const char* values) {
+    const int groupSize = stimulus.steps * stimulus.inputCount;
+    const int group = stimulus.lanes / ROWS_PER_WORD;
+    if ((group + 1) * groupSize > stimulus.capacity) {
+        const int newCapacity = std::max((group + 1) * groupSize, stimulus.capacity * 2);
+        std::uint64_t* newWords = utils::allocWordArray(newCapacity);
+        if (stimulus.words) {
+            std::memcpy(newWords, stimulus.words, sizeof(std::uint64_t) * stimulus.capacity);
+        }
+        utils::freeWordArray(stimulus.words);
+        stimulus.words = newWords;
+        stimulus.capacity = newCapacity;
+    }
+    const std::uint64_t laneBit = 1ULL << (stimulus.lanes % ROWS_PER_WORD);
+    std::uint64_t* groupWords = stimulus.words + group * groupSize;
+    for (int i = 0; i < groupSize; i++) {
+        if (values[i]) {
+            groupWords[i] |= laneBit;
+        }
+    }
+    stimulus.lanes++;
+}
+
+// Прави празна статистика за ис с дадения брой входове и изходи
+RandomStats makeRandomStats(const int argCount, const int outputCount) {
+    RandomStats stats;
+    stats.ones = utils::allocWordArray(outputCount);
+    stats.sensitive = utils::allocWordArray(argCount);
+    return stats;
+}
+
+// Освобождава паметта на дадената статистика
+void freeRandomStats(RandomStats& stats) {
+    utils::freeWordArray(stats.ones);
+    utils::freeWordArray(stats.sensitive);
+    stats.vectors = 0;
+}
+
+// Прави нов вход за ис (с аргументи в дадения алокатор, ако има такъв)
+CircuitInput makeCircuitInput(Arena* arena = nullptr) {
+    CircuitInput input;
+    input.args = makeIntVector(100, arena);
+    return input;
+}
+
+// Освобождава паметта на дадения вход
+void freeCircuitInput(CircuitInput& input) {
+    clearIntVector(input.args);
+    input.circuitName = "";
+}
+
+// Прави хранилище за ис
+CircuitStorage makeCircuitStorage(const int capacity) {
+    CircuitStorage storage;
+    storage.circuits = new IntegratedCircuit[capacity];
+    storage.capacity = capacity;
+    storage.indexCapacity = 16;
+    while (storage.indexCapacity < capacity * 2) {
+        storage.indexCapacity *= 2;
+    }
+    storage.index = utils::allocIntArray(storage.indexCapacity);
+    for (int i = 0; i < storage.indexCapacity; i++) {
+        storage.index[i] = -1;
+    }
+    return storage;
+}
+
+// Освобождава паметта за всчки ис в хронилището
+void freeCircuitStorage(CircuitStorage& storage) {
+    for (int i = 0; i < storage.size; i++) {
+        freeIntegratedCircuit(storage.circuits[i]);
+    }
+    delete[] storage.circuits;
+    storage.circuits = nullptr;
+    storage.capacity = 0;
+    storage.size = 0;
+    utils::freeIntArray(storage.index);
+    storage.indexCapacity = 0;
+}
+
+// Намира клетката в индекса, в която е (или трябва да бъде) ис с даденото име и хеш
+int findIndexSlot(const CircuitStorage& storage, const std::string& name, const std::uint64_t hash) {
+    const int mask = storage.indexCapacity - 1;
+    int slot = (int)(hash & mask);
+    while (storage.index[slot] != -1) {
+        const IntegratedCircuit& circuit = storage.circuits[storage.index[slot]];
+        if (circuit.nameHash == hash && circuit.name == name) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Удвоява размера на индекса и наново разпределя ис в него
+void growStorageIndex(CircuitStorage& storage) {
+    utils::freeIntArray(storage.index);
+    storage.indexCapacity *= 2;
+    storage.index = utils::allocIntArray(storage.indexCapacity);
+    for (int i = 0; i < storage.indexCapacity; i++) {
+        storage.index[i] = -1;
+    }
+    for (int i = 0; i < storage.size; i++) {
+        const IntegratedCircuit& circuit = storage.circuits[i];
+        storage.index[findIndexSlot(storage, circuit.name, circuit.nameHash)] = i;
+    }
+}
+
+// Удвоява капацитета на хранилището (ис се преместват, без да се копират векторите им)
+void growCircuitStorage(CircuitStorage& storage) {
+    const int newCapacity = storage.capacity > 0 ? storage.capacity * 2 : INITIAL_CIRCUITS_CAPACITY;
+    IntegratedCircuit* newCircuits = new IntegratedCircuit[newCapacity];
+    for (int i = 0; i < storage.size; i++) {
+        newCircuits[i] = std::move(storage.circuits[i]);
+    }
+    delete[] storage.circuits;
+    storage.circuits = newCircuits;
+    storage.capacity = newCapacity;
+}
+
+// Прави дълбоко копие на дадена ис в хранилището
+void addCircuit(CircuitStorage& storage, const IntegratedCircuit& circuit) {
+    if (storage.size == storage.capacity) {
+        growCircuitStorage(storage);
+    }
+    if ((storage.size + 1) * 2 > storage.indexCapacity) {
+        growStorageIndex(storage);
+    }
+    // Правим нова ис
+    storage.circuits[storage.size] = makeIntegratedCircuit();
+    auto& storageCircuit = storage.circuits[storage.size];
+    // Копираме аргументите (входа) на схемата
+    for (int i = 0; i < circuit.arguments.size; i++) {
+        pushToStringVector(storageCircuit.arguments, circuit.arguments.data[i]);
+    }
+    for (int i = 0; i < circuit.outputs.size; i++) {
+        pushToStringVector(storageCircuit.outputs, circuit.outputs.data[i]);
+    }
+    // Копираме логическия израз
+    for (int i = 0; i < circuit.tokenizedExpr.size; i++) {
+        pushToStringVector(storageCircuit.tokenizedExpr, circuit.tokenizedExpr.data[i]);
+    }
+    // Копираме останалите данни
+    storageCircuit.name = circuit.name;
+    storageCircuit.expr = circuit.expr;
+    storageCircuit.nameHash = utils::hashName(circuit.name);
+    storageCircuit.feedbackSlot = circuit.feedbackSlot;
+    // Копираме компилираната програма
+    storageCircuit.program = makeProgram(circuit.program.size + 1);
+    for (int i = 0; i < circuit.program.size; i++) {
+        pushToProgram(storageCircuit.program, circuit.program.code[i]);
+    }
+    storageCircuit.program.registerCount = circuit.program.registerCount;
+    storageCircuit.program.outputCount = circuit.program.outputCount;
+    prepareProgramStack(storageCircuit.program);
+    // Добавяме ис в индекса
+    storage.index[findIndexSlot(storage, storageCircuit.name, storageCircuit.nameHash)] =
+        storage.size;
+    // Коригираме размера на хранилището
+    storage.size++;
+}
+
+// Принтираме всички налични ис
+void printStorage(const CircuitStorage& storage) {
+    for (int i = 0; i < storage.size; i++) {
+        utils::printCircuit(storage.circuits[i]);
+    }
+}
+
+// Търсим ис в хранилището по хеш на името и я връщаме при нейното наличие
+IntegratedCircuit* findCircuit(const CircuitStorage& storage, const std::string& name) {
+    const int slot = findIndexSlot(storage, name, utils::hashName(name));
+    if (storage.index[slot] == -1) {
+        cacheCounters.lookupMisses++;
+        return nullptr;
+    }
+    cacheCounters.lookupHits++;
+    return &storage.circuits[storage.index[slot]];
+}
+
+// Проверяваме дали ис се съдържа в хранилището
+bool hasCircuit(const CircuitStorage& storage, const std::string& name) {
+    return findCircuit(storage, name) != nullptr;
+}
+
+// Пресмята с колко елемента програмният код променя стека на изпълнение. Връща -1, ако кодът
+// се опитва да вземе елемент от празния стек
+int getStackEffect(const Instruction* code, const int count) {
+    int depth = 0;
+    for (int i = 0; i < count; i++) {
+        const char op = code[i].op;
+        if (op == OP_LOAD || op == OP_CONST) {
+            depth++;
+        } else if (op == '!') {
+            if (depth < 1) {
+                return -1;
+            }
+        } else {
+            if (depth < 1 || (op != OP_STORE && depth < 2)) {
+                return -1;
+            }
+            depth--;
+        }
+    }
+    return depth;
+}
+
+// Записва всички ис от хранилището в двоичен файл с библиотека
+bool saveCircuitLibrary(const CircuitStorage& storage, const std::string& fileName) {
+    LibraryEntry* entries = new LibraryEntry[storage.size + 1];
+    std::string strings;
+    std::uint64_t codeSize = 0;
+    for (int i = 0; i < storage.size; i++) {
+        const IntegratedCircuit& circuit = storage.circuits[i];
+        LibraryEntry& entry = entries[i];
+        entry.nameHash = circuit.nameHash;
+        entry.nameOffset = strings.size();
+        entry.nameLength = (std::uint32_t)circuit.name.size();
+        strings += circuit.name;
+        entry.exprOffset = strings.size();
+        entry.exprLength = (std::uint32_t)circuit.expr.size();
+        strings += circuit.expr;
+        entry.argsOffset = strings.size();
+        entry.argCount = (std::uint32_t)circuit.arguments.size;
+        for (int k = 0; k < circuit.arguments.size; k++) {
+            strings += circuit.arguments.data[k];
+            strings += '\0';
+        }
+        entry.argsLength = (std::uint32_t)(strings.size() - entry.argsOffset);
+        entry.outputsOffset = strings.size();
+        entry.outputNameCount = (std::uint32_t)circuit.outputs.size;
+        for (int k = 0; k < circuit.outputs.size; k++) {
+            strings += circuit.outputs.data[k];
+            strings += '\0';
+        }
+        entry.outputsLength = (std::uint32_t)(strings.size() - entry.outputsOffset);
+        entry.outputCount = (std::uint32_t)circuit.program.outputCount;
+        entry.codeOffset = codeSize;
+        entry.codeSize = (std::uint32_t)circuit.program.size;
+        entry.registerCount = (std::uint32_t)circuit.program.registerCount;
+        entry.feedbackSlot = circuit.feedbackSlot;
+        codeSize += circuit.program.size;
+    }
+
+    LibraryHeader header;
+    std::memcpy(header.magic, LIBRARY_MAGIC, sizeof(header.magic));
+    header.version = LIBRARY_VERSION;
+    header.circuitCount = (std::uint32_t)storage.size;
+    header.instructionSize = sizeof(Instruction);
+    header.entriesOffset = sizeof(LibraryHeader);
+    header.codeOffset = header.entriesOffset + sizeof(LibraryEntry) * storage.size;
+    header.stringsOffset = header.codeOffset + sizeof(Instruction) * codeSize;
+    header.fileSize = header.stringsOffset + strings.size();
+
+    std::FILE* file = std::fopen(fileName.c_str(), "wb");
+    bool success = file != nullptr;
+    if (success) {
+        success = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  std::fwrite(entries, sizeof(LibraryEntry), storage.size, file) ==
+                      (std::size_t)storage.size;
+        // Инструкциите се записват с нулирани байтове за подравняване
+        Instruction instr;
+        for (int i = 0; i < storage.size && success; i++) {
+            const Program& program = storage.circuits[i].program;
+            for (int k = 0; k < program.size && success; k++) {
+                std::memset((void*)&instr, 0, sizeof(instr));
+                instr.op = program.code[k].op;
+                instr.slot = program.code[k].slot;
+                success = std::fwrite(&instr, sizeof(instr), 1, file) == 1;
+            }
+        }
+        success = success && std::fwrite(strings.data(), 1, strings.size(), file) == strings.size();
+        success = std::fclose(file) == 0 && success;
+    }
+    if (!success) {
+        std::cerr << "Failed to write circuit library to file with name " << fileName << ".\n";
+    }
+    // Освобождаваме паметта
+    delete[] entries;
+    return success;
+}
+
+namespace utils {
+// Проверява дали отрязъкът [offset, offset + length) е изцяло в област с дадения размер
+bool isInRange(const std::uint64_t offset, const std::uint64_t length, const std::uint64_t size) {
+    return offset <= size && length <= size - offset;
+}
+
+// Брои имената в списък с дадената дължина, в който всяко име завършва с '\0'. Връща -1, ако
+// някое име е празно или списъкът не завършва с '\0'
+std::int64_t countNameList(const char* list, const std::uint32_t length) {
+    std::int64_t count = 0;
+    std::uint32_t nameLength = 0;
+    for (std::uint32_t i = 0; i < length; i++) {
+        if (list[i] != '\0') {
+            nameLength++;
+        } else if (nameLength == 0) {
+            return -1;
+        } else {
+            count++;
+            nameLength = 0;
+        }
+    }
+    return nameLength == 0 ? count : -1;
+}
+
+// Проверява дали записът в библиотеката сочи в рамките на файла и програмата му е коректна. Както
+// при DEFINE, ис трябва да има поне един вход, имената на изходите са или нито едно, или по едно за
+// всеки изход, а всеки временен регистър и всеки изход изискват поне по една инструкция
+bool isValidLibraryEntry(const LibraryEntry& entry, const Instruction* code,
+                         const std::uint64_t codeCount, const char* strings,
+                         const std::uint64_t stringsSize) {
+    if (!isInRange(entry.nameOffset, entry.nameLength, stringsSize) ||
+        !isInRange(entry.exprOffset, entry.exprLength, stringsSize) ||
+        !isInRange(entry.argsOffset, entry.argsLength, stringsSize) ||
+        !isInRange(entry.outputsOffset, entry.outputsLength, stringsSize) ||
+        !isInRange(entry.codeOffset, entry.codeSize, codeCount) || entry.nameLength == 0 ||
+        entry.argCount == 0 || entry.outputCount == 0 || entry.outputCount > entry.codeSize ||
+        entry.registerCount < entry.argCount + (entry.outputCount > 1 ? entry.outputCount : 0) ||
+        (std::uint64_t)entry.registerCount >
+            (std::uint64_t)entry.argCount + entry.outputCount + entry.codeSize ||
+        entry.feedbackSlot < -1 || entry.feedbackSlot >= (std::int32_t)entry.argCount) {
+        return false;
+    }
+    if (countNameList(strings + entry.argsOffset, entry.argsLength) != entry.argCount ||
+        (entry.outputNameCount != 0 && entry.outputNameCount != entry.outputCount) ||
+        countNameList(strings + entry.outputsOffset, entry.outputsLength) !=
+            entry.outputNameCount) {
+        return false;
+    }
+    for (std::uint32_t i = 0; i < entry.codeSize; i++) {
+        const Instruction& instr = code[entry.codeOffset + i];
+        const bool usesSlot = instr.op == OP_LOAD || instr.op == OP_STORE;
+        if ((usesSlot && (instr.slot < 0 || instr.slot >= (int)entry.registerCount)) ||
+            (!usesSlot && instr.op != OP_CONST && !isOperator(instr.op))) {
+            return false;
+        }
+    }
+    return getStackEffect(code + entry.codeOffset, entry.codeSize) == 1;
+}
+
+// Добавя до count имена от списък с дадената дължина, в който всяко име завършва с '\0'
+void pushNameList(StringVector& names, const char* list, const std::uint32_t length,
+                  const std::uint32_t count) {
+    const char* listEnd = list + length;
+    for (std::uint32_t k = 0; k < count && list < listEnd; k++) {
+        const char* nameEnd = (const char*)std::memchr(list, '\0', listEnd - list);
+        nameEnd = nameEnd ? nameEnd : listEnd;
+        pushToStringVector(names, std::string(list, nameEnd));
+        list = nameEnd + 1;
+    }
+}
+}  // namespace utils
+
+// Зарежда ис от двоичен файл с библиотека. Файлът се проектира в паметта (mmap), а програмите се
+// копират директно без парсване и компилация. Схемите с вече съществуващи имена се пропускат
+void loadCircuitLibrary(CircuitStorage& storage, const std::string& fileName) {
+    const int fd = open(fileName.c_str(), O_RDONLY);
+    struct stat fileStat {};
+    if (fd == -1 || fstat(fd, &fileStat) == -1 || fileStat.st_size < (off_t)sizeof(LibraryHeader)) {
+        std::cerr << "Failed to open circuit library with name " << fileName << ".\n";
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+    const std::uint64_t fileSize = (std::uint64_t)fileStat.st_size;
+    void* mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Failed to map circuit library with name " << fileName << ".\n";
+        return;
+    }
+
+    const char* bytes = (const char*)mapped;
+    const LibraryHeader& header = *(const LibraryHeader*)bytes;
+    const bool validHeader =
+        std::memcmp(header.magic, LIBRARY_MAGIC, sizeof(header.magic)) == 0 &&
+        header.version == LIBRARY_VERSION && header.instructionSize == sizeof(Instruction) &&
+        header.fileSize == fileSize && header.entriesOffset == sizeof(LibraryHeader) &&
+        header.codeOffset ==
+            header.entriesOffset + (std::uint64_t)header.circuitCount * sizeof(LibraryEntry) &&
+        header.codeOffset <= header.stringsOffset && header.stringsOffset <= fileSize &&
+        (header.stringsOffset - header.codeOffset) % sizeof(Instruction) == 0;
+    if (!validHeader) {
+        std::cerr << "File with name " << fileName << " is not a valid circuit library.\n";
+        munmap(mapped, fileSize);
+        return;
+    }
+
+    const LibraryEntry* entries = (const LibraryEntry*)(bytes + header.entriesOffset);
+    const Instruction* code = (const Instruction*)(bytes + header.codeOffset);
+    const std::uint64_t codeCount = (header.stringsOffset - header.codeOffset) / sizeof(Instruction);
+    const char* strings = bytes + header.stringsOffset;
+    const std::uint64_t stringsSize = fileSize - header.stringsOffset;
+    int loaded = 0;
+    for (std::uint32_t i = 0; i < header.circuitCount; i++) {
+        const LibraryEntry& entry = entries[i];
+        if (!utils::isValidLibraryEntry(entry, code, codeCount, strings, stringsSize)) {
+            std::cerr << "Circuit library entry " << i << " is corrupted. Skip it.\n";
+            continue;
+        }
+        const std::string name(strings + entry.nameOffset, entry.nameLength);
+        if (hasCircuit(storage, name)) {
+            std::cerr << "Integrated circuit with name " << name
+                      << " already exist. Skip loading it.\n";
+            continue;
+        }
+
+        if (storage.size == storage.capacity) {
+            growCircuitStorage(storage);
+        }
+        if ((storage.size + 1) * 2 > storage.indexCapacity) {
+            growStorageIndex(storage);
+        }
+        // Правим нова ис направо в хранилището
+        storage.circuits[storage.size] = makeIntegratedCircuit();
+        auto& storageCircuit = storage.circuits[storage.size];
+        storageCircuit.name = name;
+        storageCircuit.expr.assign(strings + entry.exprOffset, entry.exprLength);
+        storageCircuit.nameHash = entry.nameHash;
+        storageCircuit.feedbackSlot = entry.feedbackSlot;
+        utils::pushNameList(storageCircuit.arguments, strings + entry.argsOffset, entry.argsLength,
+                            entry.argCount);
+        utils::pushNameList(storageCircuit.outputs, strings + entry.outputsOffset,
+                            entry.outputsLength, entry.outputNameCount);
+        storageCircuit.program = makeProgram(entry.codeSize + 1);
+        std::memcpy((void*)storageCircuit.program.code, code + entry.codeOffset,
+                    sizeof(Instruction) * entry.codeSize);
+        storageCircuit.program.size = (int)entry.codeSize;
+        storageCircuit.program.registerCount = (int)entry.registerCount;
+        storageCircuit.program.outputCount = (int)entry.outputCount;
+        prepareProgramStack(storageCircuit.program);
+        // Добавяме ис в индекса
+        storage.index[findIndexSlot(storage, storageCircuit.name, storageCircuit.nameHash)] =
+            storage.size;
+        storage.size++;
+        loaded++;
+    }
+    std::cout << "Loaded " << loaded << " circuits from " << fileName << '\n';
+    // Освобождаваме паметта
+    munmap(mapped, fileSize);
+}
+
+// Вгражда програмата на подсхема на мястото на извикването й. Кодът на аргументите вече е в края на
+// програмата и започва от позициите argStarts[0, argCount). Аргумент, който само зарежда регистър, се
+// подава на подсхемата директно, а останалите се записват в нови временни регистри
+bool inlineSubcircuit(Program& program, const Program& subProgram, const int* argStarts,
+                      const int argCount) {
+    const int callStart = argStarts[0];
+    const int argsCodeSize = program.size - callStart;
+    Instruction* argsCode = new Instruction[argsCodeSize + 1];
+    for (int i = 0; i < argsCodeSize; i++) {
+        argsCode[i] = program.code[callStart + i];
+    }
+    program.size = callStart;
+
+    // Съответствие между регистрите на подсхемата и тези на програмата
+    int* slotMap = utils::allocIntArray(subProgram.registerCount);
+    bool valid = true;
+    for (int k = 0; k < argCount; k++) {
+        const int begin = argStarts[k] - callStart;
+        const int end = k + 1 < argCount ? argStarts[k + 1] - callStart : argsCodeSize;
+        if (end - begin == 1 && argsCode[begin].op == OP_LOAD) {
+            slotMap[k] = argsCode[begin].slot;
+            continue;
+        }
+        if (getStackEffect(argsCode + begin, end - begin) != 1) {
+            valid = false;
+            break;
+        }
+        for (int i = begin; i < end; i++) {
+            pushToProgram(program, argsCode[i]);
+        }
+        slotMap[k] = program.registerCount++;
+        pushToProgram(program, {OP_STORE, slotMap[k]});
+    }
+    // Временните регистри на подсхемата получават нови индекси
+    for (int s = argCount; s < subProgram.registerCount; s++) {
+        slotMap[s] = program.registerCount++;
+    }
+    for (int i = 0; valid && i < subProgram.size; i++) {
+        Instruction instr = subProgram.code[i];
+        if (instr.op == OP_LOAD || instr.op == OP_STORE) {
+            instr.slot = slotMap[instr.slot];
+        }
+        pushToProgram(program, instr);
+    }
+    // Освобождаваме паметта
+    delete[] argsCode;
+    utils::freeIntArray(slotMap);
+    return valid;
+}
+
+// Компилира логическия израз на ис в програма (Shunting Yard алгоритъм, при който входовете се
+// заменят с индекса на съответния аргумент, а извикванията на други ис от хранилището се вграждат).
+// Изразите на отделните изходи са разделени със запетаи извън извикванията и се компилират в обща
+// програма, за да се пресмята общата им логика веднъж
+bool compileCircuit(IntegratedCircuit& circuit, const CircuitStorage& storage) {
+    // Маркер в стека с оператори за отворена скоба на извикване на подсхема
+    static constexpr char CALL_MARKER = '@';
+
+    const StringVector& tokens = circuit.tokenizedExpr;
+    Program& program = circuit.program;
+    freeProgram(program);
+    program = makeProgram(tokens.size + 1);
+    program.registerCount = circuit.arguments.size;
+    CharVector operators = makeCharVector(tokens.size + 1);
+    IntVector callees = makeIntVector(16);     // Индексите в хранилището на отворените извиквания
+    IntVector callFrames = makeIntVector(16);  // Къде в argStarts започват аргументите им
+    IntVector argStarts = makeIntVector(16);   // Къде в програмата започва кодът на всеки аргумент
+    int outputStart = 0;  // Къде в програмата започва кодът на текущия изход
+    int outputCount = 1;
+
+    // Премахва операторите до най-близката отворена скоба и ги добавя в програмата
+    const auto popOperators = [&]() {
+        while (operators.size > 0 && getCharVectorBack(operators) != '(' &&
+               getCharVectorBack(operators) != CALL_MARKER) {
+            pushToProgram(program, {getCharVectorBack(operators), -1});
+            popFromCharVector(operators);
+        }
+    };
+
+    bool valid = true;
+    for (int i = 0; valid && i < tokens.size; i++) {
+        const std::string& token = tokens.data[i];
+        if (utils::isCircuitCall(tokens, i)) {
+            const std::string& name = token;
+            const IntegratedCircuit* callee = findCircuit(storage, name);
+            if (!callee) {
+                std::cerr << "Circuit with name " << name << " does NOT exist.\n";
+                valid = false;
+                break;
+            }
+            if (callee->program.outputCount > 1) {
+                std::cerr << "Circuit " << name
+                          << " has several outputs and cannot be called in an expression.\n";
+                valid = false;
+                break;
+            }
+            pushToIntVector(callees, (int)(callee - storage.circuits));
+            pushToIntVector(callFrames, argStarts.size);
+            pushToIntVector(argStarts, program.size);
+            pushToCharVector(operators, CALL_MARKER);
+            // Прескачаме отварящата скоба
+            i++;
+        } else if (token == "(") {
+            pushToCharVector(operators, '(');
+        } else if (token == ",") {
+            popOperators();
+            // Запетая извън скоби започва израза на следващия изход
+            if (operators.size == 0) {
+                if (getStackEffect(program.code + outputStart, program.size - outputStart) != 1) {
+                    std::cerr << "Output " << outputCount - 1
+                              << " does not evaluate to a single value.\n";
+                    valid = false;
+                    break;
+                }
+                outputStart = program.size;
+                outputCount++;
+                continue;
+            }
+            if (getCharVectorBack(operators) != CALL_MARKER) {
+                std::cerr << "Found {,} outside of circuit call.\n";
+                valid = false;
+                break;
+            }
+            pushToIntVector(argStarts, program.size);
+        } else if (token == ")") {
+            popOperators();
+            if (operators.size == 0) {
+                std::cerr << "Mismatch in parenthesis found.\n";
+                valid = false;
+                break;
+            }
+            const char open = getCharVectorBack(operators);
+            popFromCharVector(operators);
+            if (open == CALL_MARKER) {
+                const IntegratedCircuit& callee = storage.circuits[getIntVectorBack(callees)];
+                const int frame = getIntVectorBack(callFrames);
+                const int argCount = argStarts.size - frame;
+                if (argCount != callee.arguments.size) {
+                    std::cerr << "Circuit " << callee.name << " expects " << callee.arguments.size
+                              << " arguments, got " << argCount << ".\n";
+                    valid = false;
+                    break;
+                }
+                if (!inlineSubcircuit(program, callee.program, argStarts.data + frame, argCount)) {
+                    std::cerr << "Invalid argument in call to circuit " << callee.name << ".\n";
+                    valid = false;
+                    break;
+                }
+                popFromIntVector(callees);
+                popFromIntVector(callFrames);
+                argStarts.size = frame;
+            }
+        } else if (token.size() == 1 && utils::isOperator(token[0])) {
+            while (operators.size > 0 && getCharVectorBack(operators) != '(' &&
+                   getCharVectorBack(operators) != CALL_MARKER &&
+                   utils::getPrecedence(getCharVectorBack(operators)) >
+                       utils::getPrecedence(token[0])) {
+                pushToProgram(program, {getCharVectorBack(operators), -1});
+                popFromCharVector(operators);
+            }
+            pushToCharVector(operators, token[0]);
+        } else {
+            // Входовете имат предимство пред константите 0 и 1
+            const int slot = utils::findArgumentSlot(circuit, token);
+            if (slot != -1) {
+                pushToProgram(program, {OP_LOAD, slot});
+            } else {
+                pushToProgram(program, {OP_CONST, token == "1"});
+            }
+        }
+    }
+
+    if (valid) {
+        popOperators();
+        if (operators.size > 0) {
+            std::cerr << "Mismatch in parenthesis found.\n";
+            valid = false;
+        } else if (getStackEffect(program.code + outputStart, program.size - outputStart) != 1) {
+            std::cerr << "Expression does not evaluate to a single value.\n";
+            valid = false;
+        } else {
+            program.outputCount = outputCount;
+            optimizeProgram(program, circuit.arguments.size);
+            prepareProgramStack(program);
+        }
+    }
+
+    // Освобождаваме паметта
+    clearCharVector(operators);
+    clearIntVector(callees);
+    clearIntVector(callFrames);
+    clearIntVector(argStarts);
+    return valid;
+}
+
+// Парсваме ис от стандартния вход
+IntegratedCircuit parseIntegratedCircuit(std::istream& istream, const CircuitStorage& storage) {
+    IntegratedCircuit circuit = makeIntegratedCircuit();
+
+    std::getline(istream >> std::ws, circuit.name, '(');
+    // Входовете са имена, разделени със запетаи
+    std::string argList;
+    std::getline(istream, argList, ')');
+    std::istringstream argStream(argList);
+    std::string arg;
+    while (std::getline(argStream >> std::ws, arg, ',')) {
+        arg.erase(arg.find_last_not_of(" \t") + 1);
+        if (!utils::isIdentifier(arg) || utils::findArgumentSlot(circuit, arg) != -1) {
+            std::cerr << "Invalid or repeated input name {" << arg << "}.\n";
+            freeIntegratedCircuit(circuit);
+            return circuit;
+        }
+        pushToStringVector(circuit.arguments, arg);
+    }
+    if (circuit.arguments.size == 0) {
+        std::cerr << "Integrated circuit must have at least one input.\n";
+        freeIntegratedCircuit(circuit);
+        return circuit;
+    }
+
+    std::string expression;
+    std::getline(istream, expression);
+    // Преди израза може да има имена на изходите: name(args) -> out1, out2: "expr1", "expr2"
+    const std::size_t exprBegin = expression.find_first_of("\"");
+    if (exprBegin == std::string::npos) {
+        std::cerr << "The expression of the circuit must be enclosed in quotes.\n";
+        freeIntegratedCircuit(circuit);
+        return circuit;
+    }
+    const std::string header = expression.substr(0, exprBegin);
+    const std::size_t arrow = header.find("->");
+    if (arrow != std::string::npos) {
+        std::istringstream outputStream(header.substr(arrow + 2, header.find(':') - arrow - 2));
+        std::string output;
+        while (std::getline(outputStream >> std::ws, output, ',')) {
+            output.erase(output.find_last_not_of(" \t") + 1);
+            if (!utils::isIdentifier(output) || utils::findOutputIndex(circuit, output) != -1) {
+                std::cerr << "Invalid or repeated output name {" << output << "}.\n";
+                freeIntegratedCircuit(circuit);
+                return circuit;
+            }
+            pushToStringVector(circuit.outputs, output);
+        }
+    }
+    circuit.expr = expression.substr(exprBegin);
+    // След израза може да има REG name - тогава ис е последователна и първият й изход се връща във
+    // входа name на следващия такт
+    const std::size_t exprEnd = circuit.expr.rfind('\"');
+    if (exprEnd > 0) {
+        std::istringstream tail(circuit.expr.substr(exprEnd + 1));
+        std::string keyword;
+        std::string regName;
+        if (tail >> keyword && keyword == "REG") {
+            tail >> regName;
+            circuit.feedbackSlot = utils::findArgumentSlot(circuit, regName);
+            if (circuit.feedbackSlot == -1 || tail >> keyword) {
+                std::cerr << "REG must name one of the inputs of the circuit.\n";
+                freeIntegratedCircuit(circuit);
+                return circuit;
+            }
+            circuit.expr.erase(exprEnd + 1);
+        }
+    }
+
+    utils::tokenizeExpression(circuit.tokenizedExpr, circuit.expr);
+    if (!utils::validateCircuit(circuit) || !compileCircuit(circuit, storage)) {
+        freeIntegratedCircuit(circuit);
+        return circuit;
+    }
+    // Изходите се именуват или всички, или никой (тогава при няколко изхода са out0, out1, ...)
+    const int outputCount = circuit.program.outputCount;
+    if (circuit.outputs.size == 0 && outputCount > 1) {
+        for (int i = 0; i < outputCount; i++) {
+            pushToStringVector(circuit.outputs, "out" + std::to_string(i));
+        }
+    } else if (circuit.outputs.size > 0 && circuit.outputs.size != outputCount) {
+        std::cerr << "Circuit has " << circuit.outputs.size << " output names but " << outputCount
+                  << " output expressions.\n";
+        freeIntegratedCircuit(circuit);
+    }
+
+    return circuit;
+}
+
+// Парсваме вход за ис. Аргументите трябва да са 0 или 1 - при невалиден аргумент връща вход без име
+CircuitInput parseRunCommand(std::istream& istream, Arena& arena) {
+    CircuitInput input = makeCircuitInput(&arena);
+    std::getline(istream >> std::ws, input.circuitName, '(');
+
+    char arg;
+    while (istream.get(arg) && arg != ')') {
+        if (arg == ' ' || arg == ',') {
+            continue;
+        }
+        if (arg != '0' && arg != '1') {
+            std::cerr << "Invalid argument {" << arg << "} for RUN command, expected 0 or 1.\n";
+            freeCircuitInput(input);
+            return input;
+        }
+        pushToIntVector(input.args, arg - '0');
+    }
+
+    return input;
+}
+
+// Изпълняваме ис с дадения вход. Връща изход 0, а ако outputs не е nullptr, записва в него всички
+// изходи (векторът с аргументите се разширява, за да побере и временните регистри на програмата)
+int runCircuit(const IntegratedCircuit& circuit, CircuitInput& input, int* outputs = nullptr) {
+    const int outputCount = circuit.program.outputCount;
+    const int argCount = circuit.arguments.size;
+    utils::reallocIntVector(input.args, circuit.program.registerCount + 1);
+    if (circuit.native.run) {
+        // Без outputs изходите се записват на мястото на временните регистри след аргументите
+        return circuit.native.run(input.args.data, outputs ? outputs : input.args.data + argCount);
+    }
+    const int res = utils::executeProgram(circuit.program, input.args.data);
+    for (int i = 0; outputs && i < outputCount; i++) {
+        outputs[i] = i == 0 ? res : input.args.data[argCount + i];
+    }
+    return res;
+}
+
+// Изпълняваме ис с дадения вход през кеша на резултатите й и записваме всички изходи в outputs.
+// Вход със стойности, различни от 0 и 1, се изпълнява без кеша
+int runCircuitCached(IntegratedCircuit& circuit, CircuitInput& input, int* outputs) {
+    for (int i = 0; i < input.args.size; i++) {
+        if (input.args.data[i] != 0 && input.args.data[i] != 1) {
+            return runCircuit(circuit, input, outputs);
+        }
+    }
+    prepareRunCache(circuit.runCache, circuit.arguments.size, circuit.program.outputCount);
+    if (lookupRunCache(circuit.runCache, input.args.data, outputs)) {
+        cacheCounters.runHits++;
+        return outputs[0];
+    }
+    cacheCounters.runMisses++;
+    const int res = runCircuit(circuit, input, outputs);
+    storeRunCache(circuit.runCache, input.args.data, outputs);
+    return res;
+}
+
+// Изпълнява ис побитово паралелно за slicedBackend.words думи на аргумент - чрез нативния й код
+// след COMPILE или чрез избраното ядро. Изход i се записва в res[i * words, (i + 1) * words)
+void executeCircuitSliced(const IntegratedCircuit& circuit, std::uint64_t* argMasks,
+                          std::uint64_t* stack, std::uint64_t* res) {
+    const int words = slicedBackend.words;
+    if (circuit.native.kernel) {
+        circuit.native.kernel(argMasks, res, words);
+        return;
+    }
+    slicedBackend.kernel(circuit.program, argMasks, stack, res);
+    // Изходите след първия остават в регистрите веднага след аргументите
+    const int argCount = circuit.arguments.size;
+    for (int i = 1; i < circuit.program.outputCount; i++) {
+        std::memcpy(res + i * words, argMasks + (argCount + i) * words,
+                    sizeof(std::uint64_t) * words);
+    }
+}
+
+// Изпълнява командата COMPILE - компилира програмата на ис до нативен код, който RUN, RUNFILE, ALL
+// и EQUIV използват вместо интерпретатора
+void runCompileCommand(IntegratedCircuit& circuit) {
+    freeNativeModule(circuit.native);
+    bool cached = false;
+    circuit.native = loadNativeModule(circuit.program, circuit.arguments.size, cached);
+    (cached ? cacheCounters.nativeHits : cacheCounters.nativeMisses)++;
+    if (circuit.native.kernel) {
+        std::cout << "Compiled " << circuit.name << " to native code"
+                  << (cached ? " (cached)" : "") << "\n";
+    } else {
+        std::cerr << "Circuit " << circuit.name << " stays interpreted.\n";
+    }
+}
+
+// Записва редовете [rowBegin, rowEnd) от таблицата на истинност на ис в out (по 64 реда на дума,
+// като избраното ядро обработва няколко думи наведнъж). rowBegin трябва да е кратно на размера на блока
+void renderAllRows(const IntegratedCircuit& circuit, const std::uint64_t rowBegin,
+                   const std::uint64_t rowEnd, std::string& out) {
+    const int argCount = circuit.arguments.size;
+    const int words = slicedBackend.words;
+    const std::uint64_t rowsPerBlock = (std::uint64_t)words * ROWS_PER_WORD;
+    std::uint64_t* argMasks = utils::allocWordArray(circuit.program.registerCount * words);
+    std::uint64_t* stack = utils::allocWordArray(circuit.program.maxDepth * words);
+    std::uint64_t* res = utils::allocWordArray(circuit.program.outputCount * words);
+
+    out.clear();
+    for (std::uint64_t rowBase = rowBegin; rowBase < rowEnd; rowBase += rowsPerBlock) {
+        utils::fillRowMasks(argMasks, argCount, rowBase, words);
+        executeCircuitSliced(circuit, argMasks, stack, res);
+        const std::uint64_t blockEnd = std::min(rowBase + rowsPerBlock, rowEnd);
+        // Кешът на ис се пише през указателите си, затова ис остава константна
+        if (circuit.runCache.known) {
+            storeRunCacheRows(circuit.runCache, rowBase, blockEnd, res, words);
+        }
+        for (std::uint64_t row = rowBase; row < blockEnd; row++) {
+            for (int i = 0; i < argCount - 1; i++) {
+                out += (char)('0' + ((row >> (argCount - 1 - i)) & 1));
+                out += " | ";
+            }
+            out += (char)('0' + (row & 1));
+            out += " | res:";
+            const std::uint64_t offset = row - rowBase;
+            for (int i = 0; i < circuit.program.outputCount; i++) {
+                const std::uint64_t word = res[i * words + offset / ROWS_PER_WORD];
+                out += ' ';
+                out += (char)('0' + ((word >> (offset % ROWS_PER_WORD)) & 1));
+            }
+            out += '\n';
+        }
+    }
+    // Освобождаваме паметта
+    utils::freeWordArray(argMasks);
+    utils::freeWordArray(stack);
+    utils::freeWordArray(res);
+}
+
+// Принтираме всички възможни комбинации за вход на ис заедно с резултата. Редовете се разделят на
+// последователни парчета, които до threadCount нишки пресмятат паралелно, след което се принтират
+// по ред. Нишки се пускат само за парчетата в текущия кръг. Връща false, ако нишка не може да бъде
+// пусната
+bool printAll(const IntegratedCircuit& circuit, const int threadCount) {
+    const std::uint64_t rowCount = 1ULL << circuit.arguments.size;
+    const std::uint64_t chunkCount = (rowCount + ROWS_PER_THREAD_CHUNK - 1) / ROWS_PER_THREAD_CHUNK;
+    const int maxWorkers = (int)std::min((std::uint64_t)threadCount, chunkCount);
+    std::string* buffers = new std::string[maxWorkers];
+    std::thread* workers = new std::thread[maxWorkers];
+
+    bool started = true;
+    for (std::uint64_t roundBase = 0; started && roundBase < chunkCount; roundBase += maxWorkers) {
+        const int workerCount = (int)std::min((std::uint64_t)maxWorkers, chunkCount - roundBase);
+        for (int t = 0; started && t < workerCount; t++) {
+            const std::uint64_t chunkBegin = (roundBase + t) * ROWS_PER_THREAD_CHUNK;
+            const std::uint64_t chunkEnd = std::min(chunkBegin + ROWS_PER_THREAD_CHUNK, rowCount);
+            if (workerCount == 1) {
+                renderAllRows(circuit, chunkBegin, chunkEnd, buffers[t]);
+                continue;
+            }
+            try {
+                workers[t] = std::thread(renderAllRows, std::cref(circuit), chunkBegin, chunkEnd,
+                                         std::ref(buffers[t]));
+            } catch (const std::system_error&) {
+                started = false;
+            }
+        }
+        for (int t = 0; t < workerCount; t++) {
+            if (workers[t].joinable()) {
+                workers[t].join();
+            }
+            if (started) {
+                std::cout.write(buffers[t].data(), buffers[t].size());
+            }
+        }
+        std::cout.flush();
+    }
+    // Освобождаваме паметта
+    delete[] workers;
+    delete[] buffers;
+    return started;
+}
+
+// Изпълнява командата ALL
+void runAllCommand(IntegratedCircuit& circuit, const int threadCount) {
+    if (circuit.arguments.size >= ROWS_PER_WORD) {
+        std::cerr << "Circuit " << circuit.name
+                  << " has too many inputs to enumerate. Use ALL name BDD instead.\n";
+        return;
+    }
+    std::cout << "Execute " << circuit.name << " " << circuit.expr << '\n';
+    // При малко входове ALL попълва наведнъж и кеша на резултатите от RUN
+    if (circuit.arguments.size <= RUN_CACHE_BITSET_MAX_INPUTS) {
+        prepareRunCache(circuit.runCache, circuit.arguments.size, circuit.program.outputCount);
+    }
+    if (!printAll(circuit, threadCount)) {
+        std::cerr << "Failed to start worker threads.\nSkip ALL command.\n";
+    }
+}
+
+// Изпълнява ис с vectorCount случайни вектора от парче номер chunk и натрупва статистиката им в
+// stats. Всяко парче има собствен генератор, получен от началното число и номера му, затова
+// резултатът не зависи от броя нишки. Маските на аргументите се пълнят директно със случайни думи.
+// При sensitivity ис се изпълнява още веднъж за всеки вход с обърнати негови стойности, а при dump
+// векторите и резултатите им се записват в out във формата на ALL
+void evaluateRandomChunk(const IntegratedCircuit& circuit, const std::uint64_t seed,
+                         const std::uint64_t chunk, const std::uint64_t vectorCount,
+                         const bool sensitivity, const bool dump, RandomStats& stats,
+                         std::string& out) {
+    const int argCount = circuit.arguments.size;
+    const int outputCount = circuit.program.outputCount;
+    const int words = slicedBackend.words;
+    const std::uint64_t vectorsPerBlock = (std::uint64_t)words * ROWS_PER_WORD;
+    std::uint64_t* argMasks = utils::allocWordArray(circuit.program.registerCount * words);
+    std::uint64_t* stack = utils::allocWordArray(circuit.program.maxDepth * words);
+    std::uint64_t* res = utils::allocWordArray(outputCount * words);
+    std::uint64_t* flippedRes = utils::allocWordArray(outputCount * words);
+    RandomGenerator generator = makeRandomGenerator(seed ^ (chunk * 0xD1B54A32D192ED03ULL));
+
+    out.clear();
+    for (std::uint64_t blockBase = 0; blockBase < vectorCount; blockBase += vectorsPerBlock) {
+        for (int i = 0; i < argCount * words; i++) {
+            argMasks[i] = utils::nextRandomWord(generator);
+        }
+        executeCircuitSliced(circuit, argMasks, stack, res);
+        // Маските на валидните вектори във всяка дума (последният блок може да е непълен)
+        const auto validMask = [&](const int w) {
+            const std::uint64_t wordBase = blockBase + (std::uint64_t)w * ROWS_PER_WORD;
+            if (wordBase >= vectorCount) {
+                return 0ULL;
+            }
+            const std::uint64_t lanes = vectorCount - wordBase;
+            return lanes >= ROWS_PER_WORD ? ~0ULL : (1ULL << lanes) - 1;
+        };
+        for (int o = 0; o < outputCount; o++) {
+            for (int w = 0; w < words; w++) {
+                stats.ones[o] += __builtin_popcountll(res[o * words + w] & validMask(w));
+            }
+        }
+        for (int arg = 0; sensitivity && arg < argCount; arg++) {
+            for (int w = 0; w < words; w++) {
+                argMasks[arg * words + w] = ~argMasks[arg * words + w];
+            }
+            executeCircuitSliced(circuit, argMasks, stack, flippedRes);
+            for (int w = 0; w < words; w++) {
+                argMasks[arg * words + w] = ~argMasks[arg * words + w];
+                std::uint64_t diff = 0;
+                for (int o = 0; o < outputCount; o++) {
+                    diff |= res[o * words + w] ^ flippedRes[o * words + w];
+                }
+                stats.sensitive[arg] += __builtin_popcountll(diff & validMask(w));
+            }
+        }
+        const std::uint64_t blockEnd = std::min(blockBase + vectorsPerBlock, vectorCount);
+        for (std::uint64_t lane = 0; dump && lane < blockEnd - blockBase; lane++) {
+            const int w = (int)(lane / ROWS_PER_WORD);
+            const int bit = (int)(lane % ROWS_PER_WORD);
+            for (int i = 0; i < argCount; i++) {
+                out += (char)('0' + ((argMasks[i * words + w] >> bit) & 1));
+                out += i == argCount - 1 ? " | res:" : " | ";
+            }
+            for (int o = 0; o < outputCount; o++) {
+                out += ' ';
+                out += (char)('0' + ((res[o * words + w] >> bit) & 1));
+            }
+            out += '\n';
+        }
+    }
+    stats.vectors += vectorCount;
+    // Освобождаваме паметта
+    utils::freeWordArray(argMasks);
+    utils::freeWordArray(stack);
+    utils::freeWordArray(res);
+    utils::freeWordArray(flippedRes);
+}
+
+// Принтира статистиката на RANDOM - пропускателната способност, дела на единиците на всеки изход и
+// (при sensitivity) чувствителността към всеки вход
+void printRandomStats(const IntegratedCircuit& circuit, const RandomStats& total,
+                      const std::uint64_t seed, const bool sensitivity, const double seconds) {
+    const int argCount = circuit.arguments.size;
+    const int outputCount = circuit.program.outputCount;
+    const double vectors = (double)total.vectors;
+    std::cout << "Evaluated " << total.vectors << " random vectors (seed " << seed << ") in "
+              << seconds * 1000.0 << " ms (" << (seconds > 0 ? vectors / seconds / 1e6 : 0.0)
+              << " million vectors/s)\n";
+    for (int o = 0; o < outputCount; o++) {
+        std::cout << "Output " << (circuit.outputs.size > 0 ? circuit.outputs.data[o] : "res")
+                  << ": ones " << (double)total.ones[o] / vectors << " (" << total.ones[o]
+                  << " of " << total.vectors << ")\n";
+    }
+    for (int arg = 0; sensitivity && arg < argCount; arg++) {
+        std::cout << "Input " << circuit.arguments.data[arg] << ": sensitivity "
+                  << (double)total.sensitive[arg] / vectors << '\n';
+    }
+    std::cout.flush();
+}
+
+// Изпълнява командата RANDOM - изпълнява ис с vectorCount псевдослучайни вектора (за схеми, твърде
+// широки за ALL). Векторите се разделят на парчета, които до threadCount нишки пресмятат
+// паралелно, а накрая се принтират делът на единиците на всеки изход и (при sensitivity)
+// чувствителността на изходите към всеки вход - делът на векторите, при които смяната на входа
+// променя някой изход
+void runRandomCommand(const IntegratedCircuit& circuit, const std::uint64_t vectorCount,
+                      const std::uint64_t seed, const bool sensitivity, const bool dump,
+                      const int threadCount) {
+    const int argCount = circuit.arguments.size;
+    const int outputCount = circuit.program.outputCount;
+    const std::uint64_t chunkCount =
+        (vectorCount + ROWS_PER_THREAD_CHUNK - 1) / ROWS_PER_THREAD_CHUNK;
+    const int maxWorkers = (int)std::min((std::uint64_t)threadCount, chunkCount);
+    RandomStats total = makeRandomStats(argCount, outputCount);
+    RandomStats* stats = new RandomStats[maxWorkers];
+    std::string* buffers = new std::string[maxWorkers];
+    std::thread* workers = new std::thread[maxWorkers];
+    for (int t = 0; t < maxWorkers; t++) {
+        stats[t] = makeRandomStats(argCount, outputCount);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    bool started = true;
+    for (std::uint64_t roundBase = 0; started && roundBase < chunkCount; roundBase += maxWorkers) {
+        const int workerCount = (int)std::min((std::uint64_t)maxWorkers, chunkCount - roundBase);
+        for (int t = 0; started && t < workerCount; t++) {
+            const std::uint64_t chunk = roundBase + t;
+            const std::uint64_t chunkSize =
+                std::min(ROWS_PER_THREAD_CHUNK, vectorCount - chunk * ROWS_PER_THREAD_CHUNK);
+            if (workerCount == 1) {
+                evaluateRandomChunk(circuit, seed, chunk, chunkSize, sensitivity, dump, stats[t],
+                                    buffers[t]);
+                continue;
+            }
+            try {
+                workers[t] = std::thread(evaluateRandomChunk, std::cref(circuit), seed, chunk,
+                                         chunkSize, sensitivity, dump, std::ref(stats[t]),
+                                         std::ref(buffers[t]));
+            } catch (const std::system_error&) {
+                started = false;
+            }
+        }
+        for (int t = 0; t < workerCount; t++) {
+            if (workers[t].joinable()) {
+                workers[t].join();
+            }
+            if (started) {
+                std::cout.write(buffers[t].data(), buffers[t].size());
+            }
+        }
+    }
+    for (int t = 0; t < maxWorkers; t++) {
+        total.vectors += stats[t].vectors;
+        for (int o = 0; o < outputCount; o++) {
+            total.ones[o] += stats[t].ones[o];
+        }
+        for (int arg = 0; arg < argCount; arg++) {
+            total.sensitive[arg] += stats[t].sensitive[arg];
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (started) {
+        printRandomStats(circuit, total, seed, sensitivity, elapsed.count());
+    } else {
+        std::cerr << "Failed to start worker threads.\nSkip RANDOM command.\n";
+    }
+
+    // Освобождаваме паметта
+    for (int t = 0; t < maxWorkers; t++) {
+        freeRandomStats(stats[t]);
+    }
+    freeRandomStats(total);
+    delete[] stats;
+    delete[] buffers;
+    delete[] workers;
+}
+// Строи диаграмата на решенията на ис с дадената наредба на аргументите и записва корените на
+// изходите й в roots. Връща корена на изход 0 или BDD_OVERFLOW, ако диаграмата стане твърде голяма
+int buildCircuitBdd(Bdd& bdd, const IntegratedCircuit& circuit, const int orderKind, int* roots) {
+    const int argCount = circuit.arguments.size;
+    int* order = utils::allocIntArray(argCount + 1);
+    utils::fillBddOrder(circuit.program, argCount, orderKind, order);
+    bdd = makeBdd(order, argCount);
+    utils::freeIntArray(order);
+    int root = buildBdd(bdd, circuit.program, argCount, roots);
+    for (int i = 0; i < circuit.program.outputCount; i++) {
+        root = roots[i] == BDD_OVERFLOW ? BDD_OVERFLOW : root;
+    }
+    if (root == BDD_OVERFLOW) {
+        std::cerr << "Decision diagram of circuit " << circuit.name << " exceeds " << BDD_MAX_NODES
+                  << " nodes.\n";
+    }
+    return root;
+}
+
+// Записва броя удовлетворяващи входове (точно, ако е под 2^64)
+std::string formatModelCount(const long double count, const int argCount) {
+    std::ostringstream ostream;
+    if (argCount < 64) {
+        ostream << (std::uint64_t)count;
+    } else {
+        ostream << count;
+    }
+    ostream << " of 2^" << argCount;
+    return ostream.str();
+}
+
+// Изпълнява командата ALL чрез диаграма на решенията - принтира само входовете с резултат 1, като
+// '-' означава, че резултатът не зависи от съответния аргумент. Не изброява всички 2^n входа. При
+// няколко изхода входовете се принтират поотделно за всеки изход
+void runAllBddCommand(const IntegratedCircuit& circuit, const int orderKind) {
+    Bdd bdd;
+    const int outputCount = circuit.program.outputCount;
+    int* roots = utils::allocIntArray(outputCount);
+    if (buildCircuitBdd(bdd, circuit, orderKind, roots) != BDD_OVERFLOW) {
+        std::cout << "Execute " << circuit.name << " " << circuit.expr << '\n';
+        const int argCount = circuit.arguments.size;
+        int* values = utils::allocIntArray(argCount + 1);
+        for (int output = 0; output < outputCount; output++) {
+            const int root = roots[output];
+            if (outputCount > 1) {
+                std::cout << "Output " << circuit.outputs.data[output] << ":\n";
+            }
+            for (int arg = 0; arg < argCount; arg++) {
+                values[arg] = -1;
+            }
+            std::string out;
+            visitBddCubes(bdd, root, values, [&](const int* cube) {
+                for (int i = 0; i < argCount; i++) {
+                    out += cube[i] == -1 ? '-' : (char)('0' + cube[i]);
+                    out += " | ";
+                }
+                out += "res: 1\n";
+                if ((int)out.size() >= IO_BUFFER_SIZE) {
+                    std::cout.write(out.data(), out.size());
+                    out.clear();
+                }
+            });
+            std::cout.write(out.data(), out.size());
+            std::cout << "Satisfying inputs: "
+                      << formatModelCount(countBddModels(bdd, root), argCount) << '\n';
+        }
+        utils::freeIntArray(values);
+    }
+    // Освобождаваме паметта
+    utils::freeIntArray(roots);
+    freeBdd(bdd);
+}
+
+// Изпълнява командата SAT - проверява дали ис има вход с резултат 1 и брои тези входове (за всеки
+// изход поотделно)
+void runSatCommand(const IntegratedCircuit& circuit) {
+    Bdd bdd;
+    const int outputCount = circuit.program.outputCount;
+    int* roots = utils::allocIntArray(outputCount);
+    if (buildCircuitBdd(bdd, circuit, BDD_ORDER_APPEARANCE, roots) != BDD_OVERFLOW) {
+        const int argCount = circuit.arguments.size;
+        int* values = utils::allocIntArray(argCount + 1);
+        for (int output = 0; output < outputCount; output++) {
+            const int root = roots[output];
+            if (outputCount > 1) {
+                std::cout << "Output " << circuit.outputs.data[output] << ":\n";
+            }
+            if (findBddModel(bdd, root, values)) {
+                std::cout << "Satisfiable: ";
+                for (int i = 0; i < argCount; i++) {
+                    std::cout << circuit.arguments.data[i] << "=" << values[i]
+                              << (i != argCount - 1 ? " " : "\n");
+                }
+            } else {
+                std::cout << "Unsatisfiable\n";
+            }
+            std::cout << "Satisfying inputs: "
+                      << formatModelCount(countBddModels(bdd, root), argCount) << '\n';
+        }
+        utils::freeIntArray(values);
+    }
+    // Освобождаваме паметта
+    utils::freeIntArray(roots);
+    freeBdd(bdd);
+}
+
+// Сравнява две ис с еднакъв брой аргументи и изходи на всички 2^n входа по блокове от избраното
+// ядро. Връща номера на първия ред с различен резултат на някой изход или -1, ако схемите са
+// еквивалентни
+std::int64_t findDifferingRow(const IntegratedCircuit& first, const IntegratedCircuit& second) {
+    const int argCount = first.arguments.size;
+    const int words = slicedBackend.words;
+    const std::uint64_t rowsPerBlock = (std::uint64_t)words * ROWS_PER_WORD;
+    const std::uint64_t rowCount = 1ULL << argCount;
+    std::uint64_t* firstMasks = utils::allocWordArray(first.program.registerCount * words);
+    std::uint64_t* secondMasks = utils::allocWordArray(second.program.registerCount * words);
+    std::uint64_t* stack =
+        utils::allocWordArray(std::max(first.program.maxDepth, second.program.maxDepth) * words);
+    const int outputCount = first.program.outputCount;
+    std::uint64_t* firstRes = utils::allocWordArray(outputCount * words);
+    std::uint64_t* secondRes = utils::allocWordArray(outputCount * words);
+
+    std::int64_t differingRow = -1;
+    for (std::uint64_t rowBase = 0; rowBase < rowCount && differingRow == -1;
+         rowBase += rowsPerBlock) {
+        utils::fillRowMasks(firstMasks, argCount, rowBase, words);
+        utils::fillRowMasks(secondMasks, argCount, rowBase, words);
+        executeCircuitSliced(first, firstMasks, stack, firstRes);
+        executeCircuitSliced(second, secondMasks, stack, secondRes);
+        for (int w = 0; w < words && differingRow == -1; w++) {
+            const std::uint64_t wordBase = rowBase + (std::uint64_t)w * ROWS_PER_WORD;
+            if (wordBase >= rowCount) {
+                break;
+            }
+            std::uint64_t diff = 0;
+            for (int i = 0; i < outputCount; i++) {
+                diff |= firstRes[i * words + w] ^ secondRes[i * words + w];
+            }
+            if (rowCount - wordBase < ROWS_PER_WORD) {
+                diff &= (1ULL << (rowCount - wordBase)) - 1;
+            }
+            if (diff) {
+                differingRow = (std::int64_t)(wordBase + __builtin_ctzll(diff));
+            }
+        }
+    }
+    // Освобождаваме паметта
+    utils::freeWordArray(firstMasks);
+    utils::freeWordArray(secondMasks);
+    utils::freeWordArray(stack);
+    utils::freeWordArray(firstRes);
+    utils::freeWordArray(secondRes);
+    return differingRow;
+}
+
+// Изпълнява командата EQUIV - проверява дали две ис дават еднакъв резултат на всеки вход (аргументите
+// и изходите се съпоставят по позиция). Схемите с малко входове се сравняват чрез изброяване, а
+// останалите чрез обща диаграма на решенията. При разлика принтира вход, на който резултатите се
+// различават
+void runEquivCommand(const IntegratedCircuit& first, const IntegratedCircuit& second) {
+    const int argCount = first.arguments.size;
+    if (argCount != second.arguments.size) {
+        std::cout << "Circuits " << first.name << " and " << second.name
+                  << " have different number of inputs (" << argCount << " and "
+                  << second.arguments.size << ").\n";
+        return;
+    }
+    const int outputCount = first.program.outputCount;
+    if (outputCount != second.program.outputCount) {
+        std::cout << "Circuits " << first.name << " and " << second.name
+                  << " have different number of outputs (" << outputCount << " and "
+                  << second.program.outputCount << ").\n";
+        return;
+    }
+
+    int* values = utils::allocIntArray(argCount + 1);
+    bool equivalent = true;
+    bool decided = true;
+    if (argCount <= EQUIV_EXHAUSTIVE_MAX_INPUTS) {
+        const std::int64_t row = findDifferingRow(first, second);
+        equivalent = row == -1;
+        for (int i = 0; i < argCount && !equivalent; i++) {
+            values[i] = (int)((row >> (argCount - 1 - i)) & 1);
+        }
+    } else {
+        // Двете схеми се строят в една диаграма, затова са еквивалентни точно когато корените на
+        // изходите им съвпадат
+        Bdd bdd;
+        int* firstRoots = utils::allocIntArray(outputCount);
+        int* secondRoots = utils::allocIntArray(outputCount);
+        buildCircuitBdd(bdd, first, BDD_ORDER_APPEARANCE, firstRoots);
+        buildBdd(bdd, second.program, argCount, secondRoots);
+        int diff = BDD_FALSE;
+        for (int i = 0; i < outputCount; i++) {
+            diff = applyBdd(bdd, '|', diff, applyBdd(bdd, '^', firstRoots[i], secondRoots[i]));
+        }
+        utils::freeIntArray(firstRoots);
+        utils::freeIntArray(secondRoots);
+        if (diff == BDD_OVERFLOW) {
+            std::cerr << "Decision diagrams are too large to compare.\n";
+            decided = false;
+        } else {
+            equivalent = !findBddModel(bdd, diff, values);
+        }
+        freeBdd(bdd);
+    }
+
+    if (decided && equivalent) {
+        std::cout << "Circuits " << first.name << " and " << second.name << " are equivalent."
+                  << '\n';
+    } else if (decided) {
+        std::cout << "Circuits " << first.name << " and " << second.name
+                  << " differ on input:";
+        CircuitInput input;
+        input.args = makeIntVector(argCount + 1);
+        for (int i = 0; i < argCount; i++) {
+            std::cout << " " << first.arguments.data[i] << "=" << values[i];
+            pushToIntVector(input.args, values[i]);
+        }
+        int* firstRes = utils::allocIntArray(outputCount);
+        int* secondRes = utils::allocIntArray(outputCount);
+        runCircuit(first, input, firstRes);
+        runCircuit(second, input, secondRes);
+        std::cout << " (" << first.name << ":";
+        for (int i = 0; i < outputCount; i++) {
+            std::cout << " " << firstRes[i];
+        }
+        std::cout << ", " << second.name << ":";
+        for (int i = 0; i < outputCount; i++) {
+            std::cout << " " << secondRes[i];
+        }
+        std::cout << ")\n";
+        clearIntVector(input.args);
+        utils::freeIntArray(firstRes);
+        utils::freeIntArray(secondRes);
+    }
+    // Освобождаваме паметта
+    utils::freeIntArray(values);
+}
+
+// Изпълнява ис с всички входни вектори от файл (или от стандартния вход, ако името е "-"). Всеки ред
+// съдържа един вектор от цифри 0/1, а разделителите между тях се игнорират. Файлът се чете на големи
+// парчета без заделяне на памет за всеки ред, векторите се изпълняват на блокове от избраното ядро, а
+// резултатите (по един на ред) се буферират
+void runFileCommand(const IntegratedCircuit& circuit, const std::string& fileName) {
+    std::FILE* file = fileName == "-" ? stdin : std::fopen(fileName.c_str(), "rb");
+    if (!file) {
+        std::cerr << "Failed to open input vectors file with name " << fileName << ".\n";
+        return;
+    }
+
+    const int argCount = circuit.arguments.size;
+    const int words = slicedBackend.words;
+    const int vectorsPerBlock = words * ROWS_PER_WORD;
+    std::uint64_t* argMasks = utils::allocWordArray(circuit.program.registerCount * words);
+    std::uint64_t* stack = utils::allocWordArray(circuit.program.maxDepth * words);
+    std::uint64_t* res = utils::allocWordArray(circuit.program.outputCount * words);
+    char* readBuffer = utils::allocCharArray(IO_BUFFER_SIZE);
+    std::string outBuffer;
+    const int outputCount = circuit.program.outputCount;
+    outBuffer.reserve(IO_BUFFER_SIZE + vectorsPerBlock * outputCount * 2);
+
+    // Изпълнява натрупаните вектори и записва резултатите им (изходите на вектор са на един ред)
+    const auto flushBlock = [&](const int vectorCount) {
+        executeCircuitSliced(circuit, argMasks, stack, res);
+        for (int lane = 0; lane < vectorCount; lane++) {
+            for (int i = 0; i < outputCount; i++) {
+                const std::uint64_t word = res[i * words + lane / ROWS_PER_WORD];
+                outBuffer += (char)('0' + ((word >> (lane % ROWS_PER_WORD)) & 1));
+                outBuffer += i == outputCount - 1 ? '\n' : ' ';
+            }
+        }
+        if ((int)outBuffer.size() >= IO_BUFFER_SIZE) {
+            std::cout.write(outBuffer.data(), outBuffer.size());
+            outBuffer.clear();
+        }
+        std::memset(argMasks, 0, sizeof(std::uint64_t) * argCount * words);
+    };
+
+    int lane = 0;      // Позиция на текущия вектор в блока
+    int argIdx = 0;    // Брой прочетени стойности в текущия вектор
+    int line = 1;      // Номер на текущия ред (за съобщенията за грешка)
+    bool lineError = false;
+    // Приключва текущия вектор - при грешка изчиства вече записаните му битове
+    const auto endVector = [&]() {
+        if (argIdx == 0 && !lineError) {
+            return;
+        }
+        const std::uint64_t laneBit = 1ULL << (lane % ROWS_PER_WORD);
+        if (lineError || argIdx != argCount) {
+            std::cerr << "Invalid input vector on line " << line << " (expected " << argCount
+                      << " binary values). Skip it.\n";
+            for (int i = 0; i < argCount; i++) {
+                argMasks[i * words + lane / ROWS_PER_WORD] &= ~laneBit;
+            }
+        } else if (++lane == vectorsPerBlock) {
+            flushBlock(lane);
+            lane = 0;
+        }
+        argIdx = 0;
+        lineError = false;
+    };
+
+    std::size_t bytesRead = 0;
+    while ((bytesRead = std::fread(readBuffer, 1, IO_BUFFER_SIZE, file)) > 0) {
+        for (std::size_t i = 0; i < bytesRead; i++) {
+            const char ch = readBuffer[i];
+            if (ch == '0' || ch == '1') {
+                if (argIdx < argCount && ch == '1') {
+                    argMasks[argIdx * words + lane / ROWS_PER_WORD] |= 1ULL
+                                                                       << (lane % ROWS_PER_WORD);
+                }
+                argIdx++;
+            } else if (ch == '\n') {
+                endVector();
+                line++;
+            } else if (std::isdigit(ch)) {
+                lineError = true;
+            }
+        }
+    }
+    endVector();
+    if (lane > 0) {
+        flushBlock(lane);
+    }
+    std::cout.write(outBuffer.data(), outBuffer.size());
+    std::cout.flush();
+
+    // Освобождаваме паметта
+    if (file != stdin) {
+        std::fclose(file);
+    }
+    utils::freeWordArray(argMasks);
+    utils::freeWordArray(stack);
+    utils::freeWordArray(res);
+    utils::freeCharArray(readBuffer);
+}
+
+// Парсва входните потоци за SIM от файл (или от стандартния вход, ако името е "-"). Всеки ред е един
+// поток - стойностите на входовете такт след такт (разделителите между тях се игнорират). Всички
+// потоци трябва да са с еднаква дължина, кратна на броя входове. При грешка връща потоци без данни
+Stimulus parseStimulus(const std::string& fileName, const int inputCount) {
+    Stimulus stimulus = makeStimulus(inputCount);
+    std::FILE* file = fileName == "-" ? stdin : std::fopen(fileName.c_str(), "rb");
+    if (!file) {
+        std::cerr << "Failed to open stimulus file with name " << fileName << ".\n";
+        return stimulus;
+    }
+
+    char* readBuffer = utils::allocCharArray(IO_BUFFER_SIZE);
+    CharVector values = makeCharVector(inputCount * 16);
+    int line = 1;  // Номер на текущия ред (за съобщенията за грешка)
+    bool lineError = false;
+    // Приключва текущия поток - първият валиден ред определя дължината на всички
+    const auto endStream = [&]() {
+        if (values.size == 0 && !lineError) {
+            return;
+        }
+        if (stimulus.steps == 0 && !lineError && values.size % inputCount == 0) {
+            stimulus.steps = values.size / inputCount;
+        }
+        if (lineError || values.size != stimulus.steps * inputCount) {
+            std::cerr << "Invalid stimulus on line " << line << " (expected "
+                      << (stimulus.steps > 0 ? std::to_string(stimulus.steps * inputCount)
+                                             : "a multiple of " + std::to_string(inputCount))
+                      << " binary values). Skip it.\n";
+        } else {
+            pushToStimulus(stimulus, values.data);
+        }
+        values.size = 0;
+        lineError = false;
+    };
+
+    std::size_t bytesRead = 0;
+    while ((bytesRead = std::fread(readBuffer, 1, IO_BUFFER_SIZE, file)) > 0) {
+        for (std::size_t i = 0; i < bytesRead; i++) {
+            const char ch = readBuffer[i];
+            if (ch == '0' || ch == '1') {
+                pushToCharVector(values, (char)(ch - '0'));
+            } else if (ch == '\n') {
+                endStream();
+                line++;
+            } else if (std::isdigit(ch)) {
+                lineError = true;
+            }
+        }
+    }
+    endStream();
+
+    // Освобождаваме паметта
+    if (file != stdin) {
+        std::fclose(file);
+    }
+    utils::freeCharArray(readBuffer);
+    clearCharVector(values);
+    return stimulus;
+}
+
+// Симулира потоците от групите [groupBegin, groupEnd) за cycles такта, като ядрото обработва по
+// slicedBackend.words групи наведнъж. Регистърът започва от 0, а стойността му след последния такт
+// се записва в state (по една дума на група)
+void simulateStimulusGroups(const IntegratedCircuit& circuit, const Stimulus& stimulus,
+                            const int* inputSlots, const std::int64_t cycles, const int groupBegin,
+                            const int groupEnd, std::uint64_t* state) {
+    const int words = slicedBackend.words;
+    const int inputCount = stimulus.inputCount;
+    std::uint64_t* argMasks = utils::allocWordArray(circuit.program.registerCount * words);
+    std::uint64_t* stack = utils::allocWordArray(circuit.program.maxDepth * words);
+    std::uint64_t* res = utils::allocWordArray(circuit.program.outputCount * words);
+    std::uint64_t* feedback = argMasks + circuit.feedbackSlot * words;
+
+    for (int blockBase = groupBegin; blockBase < groupEnd; blockBase += words) {
+        const int blockWords = std::min(words, groupEnd - blockBase);
+        std::memset(argMasks, 0, sizeof(std::uint64_t) * circuit.arguments.size * words);
+        int step = 0;
+        for (std::int64_t cycle = 0; cycle < cycles; cycle++) {
+            for (int w = 0; w < blockWords; w++) {
+                const std::uint64_t* stepWords =
+                    stimulus.words + ((blockBase + w) * stimulus.steps + step) * inputCount;
+                for (int i = 0; i < inputCount; i++) {
+                    argMasks[inputSlots[i] * words + w] = stepWords[i];
+                }
+            }
+            executeCircuitSliced(circuit, argMasks, stack, res);
+            std::memcpy(feedback, res, sizeof(std::uint64_t) * words);
+            if (++step == stimulus.steps) {
+                step = 0;
+            }
+        }
+        for (int w = 0; w < blockWords; w++) {
+            state[blockBase + w] = feedback[w];
+        }
+    }
+    // Освобождаваме паметта
+    utils::freeWordArray(argMasks);
+    utils::freeWordArray(stack);
+    utils::freeWordArray(res);
+}
+
+// Изпълнява командата SIM - симулира последователна ис за cycles такта с всички входни потоци от
+// файла. Потоците са независими и се изпълняват побитово паралелно (по 64 в дума), а групите им се
+// разпределят между threadCount нишки. Принтира стойността на регистъра на всеки поток след
+// последния такт и пропускателната способност
+void runSimCommand(const IntegratedCircuit& circuit, const std::int64_t cycles,
+                   const std::string& fileName, const int threadCount) {
+    if (circuit.feedbackSlot == -1) {
+        std::cerr << "Circuit " << circuit.name
+                  << " has no register. Define it with REG to simulate it.\n";
+        return;
+    }
+    const int inputCount = circuit.arguments.size - 1;
+    if (inputCount == 0) {
+        std::cerr << "Circuit " << circuit.name << " has no inputs besides its register.\n";
+        return;
+    }
+    // Входовете на ис без регистъра, в реда, в който са в потоците
+    int* inputSlots = utils::allocIntArray(inputCount);
+    for (int slot = 0, i = 0; slot < circuit.arguments.size; slot++) {
+        if (slot != circuit.feedbackSlot) {
+            inputSlots[i++] = slot;
+        }
+    }
+    Stimulus stimulus = parseStimulus(fileName, inputCount);
+    if (stimulus.lanes == 0) {
+        std::cerr << "No stimulus streams found in file with name " << fileName << ".\n";
+        utils::freeIntArray(inputSlots);
+        freeStimulus(stimulus);
+        return;
+    }
+
+    const int groupCount = (stimulus.lanes + ROWS_PER_WORD - 1) / ROWS_PER_WORD;
+    std::uint64_t* state = utils::allocWordArray(groupCount);
+    const int workerCount = std::min(threadCount, groupCount);
+    const int groupsPerWorker = (groupCount + workerCount - 1) / workerCount;
+    std::thread* workers = new std::thread[workerCount];
+    const auto start = std::chrono::steady_clock::now();
+    bool started = true;
+    for (int t = 0; started && t < workerCount; t++) {
+        const int groupBegin = std::min(t * groupsPerWorker, groupCount);
+        const int groupEnd = std::min(groupBegin + groupsPerWorker, groupCount);
+        if (workerCount == 1) {
+            simulateStimulusGroups(circuit, stimulus, inputSlots, cycles, groupBegin, groupEnd,
+                                   state);
+            continue;
+        }
+        try {
+            workers[t] = std::thread(simulateStimulusGroups, std::cref(circuit),
+                                     std::cref(stimulus), inputSlots, cycles, groupBegin, groupEnd,
+                                     state);
+        } catch (const std::system_error&) {
+            started = false;
+        }
+    }
+    for (int t = 0; t < workerCount; t++) {
+        if (workers[t].joinable()) {
+            workers[t].join();
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (!started) {
+        std::cerr << "Failed to start worker threads.\nSkip SIM command.\n";
+        // Освобождаваме паметта
+        delete[] workers;
+        utils::freeIntArray(inputSlots);
+        utils::freeWordArray(state);
+        freeStimulus(stimulus);
+        return;
+    }
+
+    std::string out;
+    out.reserve(stimulus.lanes * 2);
+    for (int lane = 0; lane < stimulus.lanes; lane++) {
+        out += (char)('0' + ((state[lane / ROWS_PER_WORD] >> (lane % ROWS_PER_WORD)) & 1));
+        out += '\n';
+    }
+    std::cout.write(out.data(), out.size());
+    const double laneCycles = (double)stimulus.lanes * (double)cycles;
+    std::cout << "Simulated " << stimulus.lanes << " streams for " << cycles << " cycles in "
+              << elapsed.count() * 1000.0 << " ms ("
+              << (elapsed.count() > 0 ? laneCycles / elapsed.count() / 1e6 : 0.0)
+              << " million cycles/s)\n";
+
+    // Освобождаваме паметта
+    delete[] workers;
+    utils::freeIntArray(inputSlots);
+    utils::freeWordArray(state);
+    freeStimulus(stimulus);
+}
+
+// Парсва таблица на истинност от даден файл. Файлът се чете на големи парчета, а всяка цифра 0/1
+// се записва директно като бит в таблицата (разделителите между цифрите се игнорират). Всички редове
+// трябва да имат еднакъв брой колони, като последните outputCount са изходите. При грешка връща
+// таблица без данни
+TruthTable parseTruthTable(const std::string& fileName, const int outputCount) {
+    TruthTable table;
+    std::FILE* file = std::fopen(fileName.c_str(), "rb");
+    if (!file) {
+        std::cerr << "Failed to parse truth table for file with name " << fileName << ".\n";
+        std::cerr
+            << "Maybe the file name is wrong or the file is missing from the working directory.\n";
+        return table;
+    }
+
+    char* readBuffer = utils::allocCharArray(IO_BUFFER_SIZE);
+    int rowCapacity = 1;  // Брой думи, заделени за текущия ред
+    std::uint64_t* row = utils::allocWordArray(rowCapacity);
+    int colIdx = 0;  // Брой прочетени стойности в текущия ред
+    int line = 1;    // Номер на текущия ред (за съобщенията за грешка)
+    bool lineError = false;
+    bool failed = false;
+    // Приключва текущия ред и го добавя в таблицата
+    const auto endRow = [&]() {
+        if (colIdx == 0 && !lineError) {
+            return;
+        }
+        if (!table.outputs && !lineError && colIdx >= outputCount) {
+            table = makeTruthTable(1024, colIdx, outputCount);
+        }
+        if (lineError || colIdx != table.cols) {
+            std::cerr << "Invalid truth table row on line " << line << " (expected "
+                      << (table.outputs ? table.cols : std::max(colIdx, outputCount))
+                      << " binary values).\n";
+            failed = true;
+        } else {
+            pushToTruthTable(table, row);
+        }
+        std::memset(row, 0, sizeof(std::uint64_t) * rowCapacity);
+        colIdx = 0;
+        lineError = false;
+    };
+
+    std::size_t bytesRead = 0;
+    while (!failed && (bytesRead = std::fread(readBuffer, 1, IO_BUFFER_SIZE, file)) > 0) {
+        for (std::size_t i = 0; i < bytesRead && !failed; i++) {
+            const char ch = readBuffer[i];
+            if (ch == '0' || ch == '1') {
+                if (colIdx == rowCapacity * 64) {
+                    std::uint64_t* newRow = utils::allocWordArray(rowCapacity * 2);
+                    for (int w = 0; w < rowCapacity; w++) {
+                        newRow[w] = row[w];
+                    }
+                    utils::freeWordArray(row);
+                    row = newRow;
+                    rowCapacity *= 2;
+                }
+                row[colIdx / 64] |= (std::uint64_t)(ch - '0') << (colIdx % 64);
+                colIdx++;
+            } else if (ch == '\n') {
+                endRow();
+                line++;
+            } else if (std::isdigit(ch) || ch == '-') {
+                lineError = true;
+            }
+        }
+    }
+    if (!failed) {
+        endRow();
+    }
+    if (!failed && !table.outputs) {
+        std::cerr << "Truth table in file with name " << fileName << " is empty.\n";
+    }
+    if (failed) {
+        freeTruthTable(table);
+    }
+
+    // Освобождаваме паметта
+    std::fclose(file);
+    utils::freeCharArray(readBuffer);
+    utils::freeWordArray(row);
+    return table;
+}
+
+// Прави синтез по 1 за дадения вход
+std::string synthLogicFuncByOne(const int* input, const int inputSize) {
+    std::string result = "(";
+    for (int i = 0; i < inputSize; i++) {
+        if (input[i] == 0) {
+            result.append("!");
+        }
+        result += utils::getArgumentName(i);
+        if (i != inputSize - 1) {
+            result += " & ";
+        }
+    }
+    result += ")";
+    return result;
+}
+
+// Изпълнява командата FIND за даден изход на таблицата
+std::string runFindCommand(const TruthTable& table, const int output) {
+    std::string logicFunc = "\"";
+    const int inputCount = utils::getTruthTableInputCount(table);
+    const std::uint64_t* outputBits = utils::getTruthTableOutput(table, output);
+    int* currInput = utils::allocIntArray(table.cols);
+    // Обхождаме само редовете с резултат 1, по 64 наведнъж от побитовото множество на изхода
+    for (int w = 0; w < (table.rows + 63) / 64; w++) {
+        for (std::uint64_t ones = outputBits[w]; ones; ones &= ones - 1) {
+            const int i = w * 64 + __builtin_ctzll(ones);
+            // Копираме входовете на ф-ята
+            for (int k = 0; k < inputCount; k++) {
+                currInput[k] = utils::getTruthTableCell(table, i, k);
+            }
+            // Синтезираме по 1
+            logicFunc += synthLogicFuncByOne(currInput, inputCount);
+            logicFunc += " | ";
+        }
+    }
+    // Освобождаваме паметта
+    utils::freeIntArray(currInput);
+
+    // Изход без редове с резултат 1 е константата 0 (както при FIND MIN)
+    if (logicFunc == "\"") {
+        return "\"0\"";
+    }
+    logicFunc = logicFunc.substr(0, logicFunc.find_last_of(')') + 1);
+    logicFunc.append("\"");
+    return logicFunc;
+}
+
+// Записва минимизираната функция като логически израз в кавички
+std::string formatCubes(const CubeVector& cubes) {
+    if (cubes.size == 0) {
+        return "\"0\"";
+    }
+    std::string logicFunc = "\"";
+    for (int i = 0; i < cubes.size; i++) {
+        const Cube& cube = cubes.data[i];
+        if (cube.mask == 0) {
+            return "\"1\"";
+        }
+        if (i > 0) {
+            logicFunc += " | ";
+        }
+        logicFunc += "(";
+        bool first = true;
+        for (int v = 0; v < 64; v++) {
+            if (!((cube.mask >> v) & 1)) {
+                continue;
+            }
+            if (!first) {
+                logicFunc += " & ";
+            }
+            if (!((cube.value >> v) & 1)) {
+                logicFunc += "!";
+            }
+            logicFunc += utils::getArgumentName(v);
+            first = false;
+        }
+        logicFunc += ")";
+    }
+    logicFunc += "\"";
+    return logicFunc;
+}
+
+// Изпълнява командата FIND с минимизация - точна (Куайн-МакКласки) за малко входове и евристична
+// (в стила на Espresso) за много. Редовете, които липсват в таблицата, са безразлични. Минимизира
+// само дадения изход на таблицата
+std::string runFindMinCommand(const TruthTable& table, const int output) {
+    const int inputCount = utils::getTruthTableInputCount(table);
+    if (inputCount < 1 || inputCount > 64) {
+        std::cerr << "Minimization supports truth tables with 1 to 64 inputs.\n";
+        return "";
+    }
+
+    MinimizeInput input;
+    input.inputCount = inputCount;
+    input.onSet = utils::allocWordArray(table.rows + 1);
+    input.offSet = utils::allocWordArray(table.rows + 1);
+    for (int i = 0; i < table.rows; i++) {
+        const std::uint64_t minterm = utils::getTruthTableInputs(table, i);
+        if (utils::getTruthTableCell(table, i, inputCount + output) == 1) {
+            input.onSet[input.onSize++] = minterm;
+        } else {
+            input.offSet[input.offSize++] = minterm;
+        }
+    }
+
+    // Проверяваме за противоречиви редове (един и същ вход с различен резултат)
+    std::sort(input.onSet, input.onSet + input.onSize);
+    std::sort(input.offSet, input.offSet + input.offSize);
+    bool conflict = false;
+    for (int i = 0, j = 0; i < input.onSize && j < input.offSize && !conflict;) {
+        conflict = input.onSet[i] == input.offSet[j];
+        input.onSet[i] < input.offSet[j] ? i++ : j++;
+    }
+
+    std::string logicFunc;
+    if (conflict) {
+        std::cerr << "Truth table contains the same input with different results.\n";
+    } else {
+        CubeVector cubes = minimizeFunction(input);
+        logicFunc = formatCubes(cubes);
+        clearCubeVector(cubes);
+    }
+    // Освобождаваме паметта
+    utils::freeWordArray(input.onSet);
+    utils::freeWordArray(input.offSet);
+    return logicFunc;
+}
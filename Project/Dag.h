@@ -0,0 +1,318 @@
+#pragma once
+
+// C++ system includes
+#include <cstdint>
+
+// Own includes
+#include "Program.h"
+#include "Utils.h"
+
+// Съдържа насочения ацикличен граф (DAG) на логически израз, чрез който се оптимизират
+// компилираните програми - еднаквите подизрази се пресмятат само веднъж, а константите се сгъват
+
+// Възел от графа. Възлите се добавят след операндите си, затова индексите им са топологично подредени
+struct DagNode {
+    char op = 0;     // OP_LOAD, OP_CONST или някой от логическите оператори '!', '&', '|'
+    int left = -1;   // Регистърът (OP_LOAD), стойността (OP_CONST) или първият операнд
+    int right = -1;  // Вторият операнд на '&' и '|'
+};
+
+// Граф със структурно хеширане - всеки възел (op, left, right) съществува само веднъж
+struct Dag {
+    DagNode* nodes = nullptr;
+    int size = 0;
+    int capacity = 0;
+    int* table = nullptr;  // Хеш таблица с индексите на възлите (-1 е празна клетка)
+    int tableCapacity = 0;  // Винаги е степен на 2
+};
+
+namespace utils {
+// Пресмята хеш на възел от графа
+std::uint64_t hashDagNode(const char op, const int left, const int right) {
+    std::uint64_t hash = (std::uint64_t)(unsigned char)op;
+    hash = hash * 0x9E3779B97F4A7C15ULL + (std::uint32_t)left;
+    hash = hash * 0x9E3779B97F4A7C15ULL + (std::uint32_t)right;
+    return hash ^ (hash >> 29);
+}
+}  // namespace utils
+
+// Прави нов граф
+Dag makeDag(const int capacity) {
+    Dag dag;
+    dag.nodes = new DagNode[capacity];
+    dag.capacity = capacity;
+    dag.tableCapacity = 16;
+    while (dag.tableCapacity < capacity * 2) {
+        dag.tableCapacity *= 2;
+    }
+    dag.table = utils::allocIntArray(dag.tableCapacity);
+    for (int i = 0; i < dag.tableCapacity; i++) {
+        dag.table[i] = -1;
+    }
+    return dag;
+}
+
+// Освобождава паметта на дадения граф
+void freeDag(Dag& dag) {
+    delete[] dag.nodes;
+    dag.nodes = nullptr;
+    dag.capacity = 0;
+    dag.size = 0;
+    utils::freeIntArray(dag.table);
+    dag.tableCapacity = 0;
+}
+
+// Намира клетката в хеш таблицата, в която е (или трябва да бъде) дадения възел
+int findDagSlot(const Dag& dag, const char op, const int left, const int right) {
+    const int mask = dag.tableCapacity - 1;
+    int slot = (int)(utils::hashDagNode(op, left, right) & mask);
+    while (dag.table[slot] != -1) {
+        const DagNode& node = dag.nodes[dag.table[slot]];
+        if (node.op == op && node.left == left && node.right == right) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Връща индекса на възела (op, left, right), като го добавя, ако все още не съществува
+int addDagNode(Dag& dag, const char op, const int left, const int right) {
+    int slot = findDagSlot(dag, op, left, right);
+    if (dag.table[slot] != -1) {
+        return dag.table[slot];
+    }
+
+    if (dag.size == dag.capacity) {
+        const int newCapacity = dag.capacity > 0 ? dag.capacity * 2 : 16;
+        DagNode* newNodes = new DagNode[newCapacity];
+        for (int i = 0; i < dag.size; i++) {
+            newNodes[i] = dag.nodes[i];
+        }
+        delete[] dag.nodes;
+        dag.nodes = newNodes;
+        dag.capacity = newCapacity;
+    }
+    if ((dag.size + 1) * 2 > dag.tableCapacity) {
+        utils::freeIntArray(dag.table);
+        dag.tableCapacity *= 2;
+        dag.table = utils::allocIntArray(dag.tableCapacity);
+        for (int i = 0; i < dag.tableCapacity; i++) {
+            dag.table[i] = -1;
+        }
+        for (int i = 0; i < dag.size; i++) {
+            const DagNode& node = dag.nodes[i];
+            dag.table[findDagSlot(dag, node.op, node.left, node.right)] = i;
+        }
+        slot = findDagSlot(dag, op, left, right);
+    }
+
+    dag.nodes[dag.size] = {op, left, right};
+    dag.table[slot] = dag.size;
+    return dag.size++;
+}
+
+// Проверява дали възелът е константа със зададената стойност
+bool isDagConst(const Dag& dag, const int node, const int value) {
+    return dag.nodes[node].op == OP_CONST && dag.nodes[node].left == value;
+}
+
+// Проверява дали единият възел е отрицание на другия
+bool isDagComplement(const Dag& dag, const int a, const int b) {
+    return (dag.nodes[a].op == '!' && dag.nodes[a].left == b) ||
+           (dag.nodes[b].op == '!' && dag.nodes[b].left == a);
+}
+
+// Добавя отрицание на възел (!!x = x, !0 = 1, !1 = 0)
+int makeDagNot(Dag& dag, const int operand) {
+    const DagNode& node = dag.nodes[operand];
+    if (node.op == '!') {
+        return node.left;
+    }
+    if (node.op == OP_CONST) {
+        return addDagNode(dag, OP_CONST, !node.left, -1);
+    }
+    return addDagNode(dag, '!', operand, -1);
+}
+
+// Добавя '&' или '|' на два възела, като сгъва константите и тривиалните случаи
+// (x & 0 = 0, x & 1 = x, x & x = x, x & !x = 0 и съответните за '|')
+int makeDagBinary(Dag& dag, const char op, int a, int b) {
+    // Поглъщащата и неутралната стойност на оператора
+    const int absorbing = op == '&' ? 0 : 1;
+    if (isDagConst(dag, a, absorbing) || isDagConst(dag, b, absorbing)) {
+        return addDagNode(dag, OP_CONST, absorbing, -1);
+    }
+    if (isDagConst(dag, a, !absorbing)) {
+        return b;
+    }
+    if (isDagConst(dag, b, !absorbing) || a == b) {
+        return a;
+    }
+    if (isDagComplement(dag, a, b)) {
+        return addDagNode(dag, OP_CONST, absorbing, -1);
+    }
+    // Операторите са комутативни, затова подреждаме операндите
+    if (a > b) {
+        const int tmp = a;
+        a = b;
+        b = tmp;
+    }
+    return addDagNode(dag, op, a, b);
+}
+
+// Изпълнява програмата символно и добавя израза й в графа. Записва корените на изходите в roots
+// (program.outputCount на брой - изходите остават на стека един след друг)
+void buildDag(Dag& dag, const Program& program, const int argCount, int* roots) {
+    int* registers = utils::allocIntArray(program.registerCount);
+    int* stack = utils::allocIntArray(program.size + 1);
+    int top = -1;
+    for (int slot = 0; slot < argCount; slot++) {
+        registers[slot] = addDagNode(dag, OP_LOAD, slot, -1);
+    }
+    for (int i = 0; i < program.size; i++) {
+        const Instruction& instr = program.code[i];
+        switch (instr.op) {
+        case OP_LOAD:
+            stack[++top] = registers[instr.slot];
+            break;
+        case OP_STORE:
+            registers[instr.slot] = stack[top--];
+            break;
+        case OP_CONST:
+            stack[++top] = addDagNode(dag, OP_CONST, instr.slot, -1);
+            break;
+        case '!':
+            stack[top] = makeDagNot(dag, stack[top]);
+            break;
+        default:
+            stack[top - 1] = makeDagBinary(dag, instr.op, stack[top - 1], stack[top]);
+            top--;
+        }
+    }
+    assert(top == program.outputCount - 1 && "Something is wrong");
+    for (int i = 0; i < program.outputCount; i++) {
+        roots[i] = stack[i];
+    }
+    // Освобождаваме паметта
+    utils::freeIntArray(registers);
+    utils::freeIntArray(stack);
+}
+
+// Генерира програма от графа с изходи в дадените корени. Възлите, които се използват повече от
+// веднъж (включително от различни изходи), се пресмятат само веднъж и се пазят във временни
+// регистри. От двата операнда първо се пресмята този, който изисква по-дълбок стек (Sethi-Ullman),
+// за да е минимална дълбочината на стека
+Program emitProgram(const Dag& dag, const int* roots, const int outputCount, const int argCount) {
+    int root = 0;  // Най-големият корен - индексите на всички достижими възли са до него
+    for (int i = 0; i < outputCount; i++) {
+        root = roots[i] > root ? roots[i] : root;
+    }
+    Program program = makeProgram(dag.size * 2 + outputCount * 2 + 1);
+    program.outputCount = outputCount;
+    // При няколко изхода регистрите веднага след аргументите са за изходите
+    program.registerCount = argCount + (outputCount > 1 ? outputCount : 0);
+    int* refCount = utils::allocIntArray(root + 1);
+    int* need = utils::allocIntArray(root + 1);
+    int* tempSlot = utils::allocIntArray(root + 1);
+    // Стек за обхождане на графа без рекурсия - възел и етап на обработката му
+    int* nodeStack = utils::allocIntArray(root + 2);
+    int* stageStack = utils::allocIntArray(root + 2);
+    int top = -1;
+
+    // Броим колко пъти се използва всеки достижим от корените възел
+    for (int i = 0; i < outputCount; i++) {
+        refCount[roots[i]]++;
+    }
+    for (int i = root; i >= 0; i--) {
+        const DagNode& node = dag.nodes[i];
+        if (refCount[i] == 0 || node.op == OP_LOAD || node.op == OP_CONST) {
+            continue;
+        }
+        refCount[node.left]++;
+        if (node.op != '!') {
+            refCount[node.right]++;
+        }
+    }
+    // Пресмятаме необходимата дълбочина на стека за всеки възел
+    for (int i = 0; i <= root; i++) {
+        const DagNode& node = dag.nodes[i];
+        tempSlot[i] = -1;
+        if (node.op == OP_LOAD || node.op == OP_CONST) {
+            need[i] = 1;
+        } else if (node.op == '!') {
+            need[i] = need[node.left];
+        } else {
+            const int l = need[node.left];
+            const int r = need[node.right];
+            need[i] = l == r ? l + 1 : (l > r ? l : r);
+        }
+    }
+
+    for (int output = 0; output < outputCount; output++) {
+        nodeStack[++top] = roots[output];
+        stageStack[top] = 0;
+        while (top >= 0) {
+            const int i = nodeStack[top];
+            const DagNode& node = dag.nodes[i];
+            // Първият операнд е този с по-голяма нужда от стек
+            const bool binary = node.op == '&' || node.op == '|';
+            const bool leftFirst = !binary || need[node.left] >= need[node.right];
+            const int first = leftFirst ? node.left : node.right;
+            const int second = leftFirst ? node.right : node.left;
+            if (stageStack[top] == 0) {
+                if (tempSlot[i] != -1) {
+                    pushToProgram(program, {OP_LOAD, tempSlot[i]});
+                    top--;
+                } else if (node.op == OP_LOAD || node.op == OP_CONST) {
+                    pushToProgram(program, {node.op, node.left});
+                    top--;
+                } else {
+                    stageStack[top] = node.op == '!' ? 2 : 1;
+                    nodeStack[++top] = first;
+                    stageStack[top] = 0;
+                }
+            } else if (stageStack[top] == 1) {
+                stageStack[top] = 2;
+                nodeStack[++top] = second;
+                stageStack[top] = 0;
+            } else {
+                pushToProgram(program, {node.op, -1});
+                if (refCount[i] > 1) {
+                    tempSlot[i] = program.registerCount++;
+                    pushToProgram(program, {OP_STORE, tempSlot[i]});
+                    pushToProgram(program, {OP_LOAD, tempSlot[i]});
+                }
+                top--;
+            }
+        }
+        if (outputCount > 1) {
+            pushToProgram(program, {OP_STORE, argCount + output});
+        }
+    }
+    // Изход 0 остава на върха на стека
+    if (outputCount > 1) {
+        pushToProgram(program, {OP_LOAD, argCount});
+    }
+
+    // Освобождаваме паметта
+    utils::freeIntArray(refCount);
+    utils::freeIntArray(need);
+    utils::freeIntArray(tempSlot);
+    utils::freeIntArray(nodeStack);
+    utils::freeIntArray(stageStack);
+    return program;
+}
+
+// Оптимизира програмата чрез графа на израза й (премахва повторените подизрази и сгъва константите)
+void optimizeProgram(Program& program, const int argCount) {
+    Dag dag = makeDag(program.size + argCount + 1);
+    int* roots = utils::allocIntArray(program.outputCount);
+    buildDag(dag, program, argCount, roots);
+    Program optimized = emitProgram(dag, roots, program.outputCount, argCount);
+    freeProgram(program);
+    program = optimized;
+    // Освобождаваме паметта
+    utils::freeIntArray(roots);
+    freeDag(dag);
+}
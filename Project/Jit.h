@@ -0,0 +1,256 @@
+#pragma once
+
+// C++ system includes
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// POSIX includes
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+// Own includes
+#include "Program.h"
+
+#ifdef CIRCUIT_X86_KERNELS
+#include <cpuid.h>
+#endif
+
+// Съдържа компилацията на програмите на ис до нативен код - програмата се превежда до C++ функция
+// над 64-битови маски, компилира се с локалния компилатор до споделена библиотека и се зарежда с
+// dlopen. Библиотеките се пазят в директория по хеш на програмата, компилатора и процесора, и при
+// повторна компилация направо се зареждат
+
+// Директория за генерираните библиотеки (може да се смени с променливата CIRCUIT_JIT_CACHE)
+static constexpr const char* JIT_DEFAULT_CACHE_DIR = ".circuit_cache";
+// Компилатор (може да се смени с променливата CIRCUIT_JIT_CXX)
+static constexpr const char* JIT_DEFAULT_COMPILER = "c++";
+// Флагове на компилатора. Кодът се оптимизира за текущия процесор само на x86, където наборът му от
+// инструкции участва в хеша на библиотеката
+#ifdef CIRCUIT_X86_KERNELS
+static constexpr const char* JIT_COMPILE_FLAGS = "-O2 -march=native -shared -fPIC";
+#else
+static constexpr const char* JIT_COMPILE_FLAGS = "-O2 -shared -fPIC";
+#endif
+// Версия на генерирания код - участва в хеша, за да не се зареждат библиотеки от стар формат
+static constexpr std::uint64_t JIT_CODE_VERSION = 2;
+
+// Побитово паралелно изпълнение със същата подредба на маските като при SlicedKernel. Изход i се
+// записва в result[i * words, (i + 1) * words)
+using NativeKernel = void (*)(const std::uint64_t* registers, std::uint64_t* result, int words);
+// Изпълнение с един вход (стойностите на аргументите са 0 или 1). Връща изход 0 и записва всички
+// изходи в outputs
+using NativeRun = int (*)(const int* args, int* outputs);
+
+// Заредена библиотека с нативния код на една програма
+struct NativeModule {
+    void* handle = nullptr;
+    NativeKernel kernel = nullptr;
+    NativeRun run = nullptr;
+};
+
+namespace utils {
+// Връща описание на набора от инструкции на процесора, за който -march=native компилира - битовете
+// с разширенията от cpuid на x86 или архитектурата на машината на останалите процесори
+std::string getNativeTarget() {
+    std::string target;
+#ifdef CIRCUIT_X86_KERNELS
+    // Листове на cpuid с разширенията на процесора (основни, разширени и AMD)
+    static constexpr unsigned int leaves[][2] = {{1, 0}, {7, 0}, {7, 1}, {0x80000001, 0}};
+    char words[64];
+    for (const auto& leaf : leaves) {
+        unsigned int eax = 0;
+        unsigned int ebx = 0;
+        unsigned int ecx = 0;
+        unsigned int edx = 0;
+        __get_cpuid_count(leaf[0], leaf[1], &eax, &ebx, &ecx, &edx);
+        std::snprintf(words, sizeof(words), "%08x%08x%08x%08x/", eax, ebx, ecx, edx);
+        target += words;
+    }
+#else
+    struct utsname host {};
+    uname(&host);
+    target = host.machine;
+#endif
+    return target;
+}
+
+// Пресмята хеш на програмата (FNV-1a), по който се именуват библиотеките в директорията. В него
+// участват и командата на компилатора, и процесорът (toolchain), за да не се зареди библиотека,
+// компилирана с друг компилатор или за друг процесор в обща директория
+std::uint64_t hashProgram(const Program& program, const int argCount,
+                          const std::string& toolchain) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    const auto mix = [&hash](const std::uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 1099511628211ULL;
+        }
+    };
+    mix(JIT_CODE_VERSION);
+    for (const auto ch : toolchain) {
+        mix((std::uint64_t)(unsigned char)ch);
+    }
+    mix((std::uint64_t)argCount);
+    mix((std::uint64_t)program.outputCount);
+    for (int i = 0; i < program.size; i++) {
+        mix((std::uint64_t)(unsigned char)program.code[i].op);
+        mix((std::uint64_t)(std::uint32_t)program.code[i].slot);
+    }
+    return hash;
+}
+
+// Генерира тялото на функцията - по една променлива за всяка междинна стойност. argLoad е изразът,
+// който зарежда аргумент (с %d на мястото на индекса му). Връща името на променливата с резултата
+std::string generateNativeBody(const Program& program, const int argCount, const char* argLoad,
+                               std::string& body) {
+    std::string* stack = new std::string[program.size + 1];
+    bool* declared = new bool[program.registerCount + 1]{};
+    int top = -1;
+    int valueCount = 0;
+    char line[256];
+    for (int i = 0; i < program.size; i++) {
+        const Instruction& instr = program.code[i];
+        const std::string value = "v" + std::to_string(valueCount);
+        switch (instr.op) {
+        case OP_LOAD:
+            if (instr.slot < argCount && !declared[instr.slot]) {
+                std::snprintf(line, sizeof(line), argLoad, instr.slot);
+                body += "        const std::uint64_t r" + std::to_string(instr.slot) + " = " + line +
+                        ";\n";
+                declared[instr.slot] = true;
+            }
+            stack[++top] = "r" + std::to_string(instr.slot);
+            break;
+        case OP_CONST:
+            stack[++top] = instr.slot ? "~0ULL" : "0ULL";
+            break;
+        case OP_STORE:
+            body += "        " + std::string(declared[instr.slot] ? "" : "std::uint64_t ") + "r" +
+                    std::to_string(instr.slot) + " = " + stack[top--] + ";\n";
+            declared[instr.slot] = true;
+            break;
+        case '!':
+            body += "        const std::uint64_t " + value + " = ~" + stack[top] + ";\n";
+            stack[top] = value;
+            valueCount++;
+            break;
+        default:
+            body += "        const std::uint64_t " + value + " = " + stack[top - 1] + " " +
+                    instr.op + " " + stack[top] + ";\n";
+            stack[--top] = value;
+            valueCount++;
+        }
+    }
+    const std::string result = top >= 0 ? stack[top] : "0ULL";
+    // Освобождаваме паметта
+    delete[] stack;
+    delete[] declared;
+    return result;
+}
+
+// Генерира C++ кода на програмата - побитово паралелно ядро и изпълнение с един вход
+std::string generateNativeSource(const Program& program, const int argCount) {
+    std::string source = "// Generated from a compiled integrated circuit. Do not edit.\n"
+                         "#include <cstdint>\n\n"
+                         "extern \"C\" void circuit_kernel(const std::uint64_t* registers, "
+                         "std::uint64_t* result, int words) {\n"
+                         "    for (int w = 0; w < words; w++) {\n";
+    std::string body;
+    std::string result = generateNativeBody(program, argCount, "registers[%d * words + w]", body);
+    source += body + "        result[w] = " + result + ";\n";
+    // Изходите след първия са в регистрите веднага след аргументите
+    for (int i = 1; i < program.outputCount; i++) {
+        source += "        result[" + std::to_string(i) + " * words + w] = r" +
+                  std::to_string(argCount + i) + ";\n";
+    }
+    source += "    }\n}\n\n";
+    source += "extern \"C\" int circuit_run(const int* args, int* outputs) {\n    {\n";
+    body.clear();
+    result = generateNativeBody(program, argCount, "(args[%d] ? ~0ULL : 0ULL)", body);
+    source += body + "        outputs[0] = (int)(" + result + " & 1);\n";
+    for (int i = 1; i < program.outputCount; i++) {
+        source += "        outputs[" + std::to_string(i) + "] = (int)(r" +
+                  std::to_string(argCount + i) + " & 1);\n";
+    }
+    source += "        return outputs[0];\n    }\n}\n";
+    return source;
+}
+
+// Връща стойността на променлива от средата или стойността по подразбиране
+std::string getEnvOr(const char* name, const char* fallback) {
+    const char* value = std::getenv(name);
+    return value && *value ? value : fallback;
+}
+}  // namespace utils
+
+// Освобождава заредената библиотека
+void freeNativeModule(NativeModule& module) {
+    if (module.handle) {
+        dlclose(module.handle);
+    }
+    module.handle = nullptr;
+    module.kernel = nullptr;
+    module.run = nullptr;
+}
+
+// Зарежда нативния код на програмата - от директорията, ако вече е компилиран (cached става true),
+// или като генерира и компилира C++ кода. При грешка връща модул без функции
+NativeModule loadNativeModule(const Program& program, const int argCount, bool& cached) {
+    NativeModule module;
+    const std::string cacheDir = utils::getEnvOr("CIRCUIT_JIT_CACHE", JIT_DEFAULT_CACHE_DIR);
+    const std::string compiler =
+        utils::getEnvOr("CIRCUIT_JIT_CXX", JIT_DEFAULT_COMPILER) + " " + JIT_COMPILE_FLAGS;
+    char hashText[17];
+    std::snprintf(
+        hashText, sizeof(hashText), "%016llx",
+        (unsigned long long)utils::hashProgram(program, argCount,
+                                               compiler + " " + utils::getNativeTarget()));
+    const std::string basePath = cacheDir + "/circuit_" + hashText;
+    const std::string libraryPath = basePath + ".so";
+
+    struct stat fileStat {};
+    cached = stat(libraryPath.c_str(), &fileStat) == 0;
+    if (!cached) {
+        mkdir(cacheDir.c_str(), 0755);
+        // Кодът и библиотеката се записват под временни имена с номера на процеса и се преименуват
+        // накрая, за да не се зареди недовършен файл и процеси с обща директория да не си пречат
+        const std::string tempBase = basePath + "." + std::to_string(getpid()) + ".tmp";
+        const std::string sourcePath = tempBase + ".cpp";
+        std::FILE* file = std::fopen(sourcePath.c_str(), "w");
+        if (!file) {
+            std::cerr << "Failed to write native code to " << sourcePath << ".\n";
+            return module;
+        }
+        const std::string source = utils::generateNativeSource(program, argCount);
+        std::fwrite(source.data(), 1, source.size(), file);
+        std::fclose(file);
+
+        const std::string tempPath = tempBase + ".so";
+        const std::string command = compiler + " -o \"" + tempPath + "\" \"" + sourcePath + "\"";
+        if (std::system(command.c_str()) != 0 ||
+            std::rename(tempPath.c_str(), libraryPath.c_str()) != 0) {
+            std::cerr << "Failed to compile native code with: " << command << "\n";
+            std::remove(tempPath.c_str());
+            std::remove(sourcePath.c_str());
+            return module;
+        }
+        std::rename(sourcePath.c_str(), (basePath + ".cpp").c_str());
+    }
+
+    module.handle = dlopen(libraryPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!module.handle) {
+        std::cerr << "Failed to load native code: " << dlerror() << "\n";
+        return module;
+    }
+    module.kernel = (NativeKernel)dlsym(module.handle, "circuit_kernel");
+    module.run = (NativeRun)dlsym(module.handle, "circuit_run");
+    if (!module.kernel || !module.run) {
+        std::cerr << "Native code in " << libraryPath << " is missing its entry points.\n";
+        freeNativeModule(module);
+    }
+    return module;
+}
@@ -0,0 +1,147 @@
+// C++ system includes
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+
+// Own includes
+#include "Program.h"
+
+// Сравнява ядрата за побитово паралелно изпълнение с интерпретатора utils::executeProgram.
+// Генерира случайни програми (с константи и временни регистри) и за всяко ядро, което процесорът
+// поддържа, проверява, че всеки бит от резултата съвпада с изпълнението на съответния вход
+
+// Брой генерирани програми
+static constexpr auto TEST_PROGRAM_COUNT = 2000;
+// Начално число на генератора (за възпроизводими програми)
+static constexpr std::uint64_t TEST_SEED = 3;
+
+// Ядро, което се проверява
+struct TestKernel {
+    const char* name = "";
+    int words = 1;
+    SlicedKernel kernel = nullptr;
+};
+
+// Връща случайно число в [0, bound)
+int nextRandomBelow(RandomGenerator& generator, const int bound) {
+    return (int)(utils::nextRandomWord(generator) % (std::uint64_t)bound);
+}
+
+// Генерира случайна програма с argCount аргумента. Временните регистри се зареждат само след като
+// са записани, а в края на стека остава една стойност
+Program generateProgram(RandomGenerator& generator, const int argCount) {
+    const int tempCount = nextRandomBelow(generator, 4);
+    const int length = 1 + nextRandomBelow(generator, 60);
+    Program program = makeProgram(length * 2 + 4);
+    program.registerCount = argCount + tempCount;
+    bool* stored = new bool[tempCount + 1]{};
+    int depth = 0;
+    for (int i = 0; i < length || depth != 1; i++) {
+        const int choice = nextRandomBelow(generator, 10);
+        const bool finishing = i >= length;
+        if (depth >= 2 && (finishing || choice < 4)) {
+            pushToProgram(program, {choice % 2 ? '&' : '|', -1});
+            depth--;
+        } else if (depth >= 1 && choice == 4) {
+            pushToProgram(program, {'!', -1});
+        } else if (depth >= 1 && choice == 5 && tempCount > 0) {
+            const int temp = nextRandomBelow(generator, tempCount);
+            pushToProgram(program, {OP_STORE, argCount + temp});
+            stored[temp] = true;
+            depth--;
+        } else if (finishing && depth == 0) {
+            pushToProgram(program, {OP_LOAD, nextRandomBelow(generator, argCount)});
+            depth++;
+        } else if (!finishing && choice == 6) {
+            pushToProgram(program, {OP_CONST, nextRandomBelow(generator, 2)});
+            depth++;
+        } else if (!finishing) {
+            const int temp = tempCount > 0 ? nextRandomBelow(generator, tempCount) : 0;
+            const bool loadTemp = tempCount > 0 && stored[temp] && choice == 7;
+            const int slot = loadTemp ? argCount + temp : nextRandomBelow(generator, argCount);
+            pushToProgram(program, {OP_LOAD, slot});
+            depth++;
+        }
+    }
+    prepareProgramStack(program);
+    // Освобождаваме паметта
+    delete[] stored;
+    return program;
+}
+
+// Изпълнява програмата с ядрото и сравнява всеки бит от резултата с интерпретатора. Връща броя
+// несъвпадащи входове
+int compareKernel(const TestKernel& kernel, const Program& program, const int argCount,
+                  RandomGenerator& generator) {
+    const int words = kernel.words;
+    std::uint64_t* registers = utils::allocWordArray(program.registerCount * words);
+    std::uint64_t* stack = utils::allocWordArray((program.maxDepth + 1) * words);
+    std::uint64_t* result = utils::allocWordArray(words);
+    int* scalarRegisters = utils::allocIntArray(program.registerCount + 1);
+    for (int i = 0; i < argCount * words; i++) {
+        registers[i] = utils::nextRandomWord(generator);
+    }
+    // Ядрото записва във временните регистри, затова аргументите се четат преди изпълнението му
+    std::uint64_t* args = utils::allocWordArray(argCount * words);
+    for (int i = 0; i < argCount * words; i++) {
+        args[i] = registers[i];
+    }
+    kernel.kernel(program, registers, stack, result);
+
+    int mismatches = 0;
+    for (int lane = 0; lane < words * ROWS_PER_WORD; lane++) {
+        const int w = lane / ROWS_PER_WORD;
+        const int bit = lane % ROWS_PER_WORD;
+        for (int i = 0; i < argCount; i++) {
+            scalarRegisters[i] = (int)((args[i * words + w] >> bit) & 1);
+        }
+        const int expected = utils::executeProgram(program, scalarRegisters);
+        mismatches += expected != (int)((result[w] >> bit) & 1);
+    }
+    // Освобождаваме паметта
+    utils::freeWordArray(registers);
+    utils::freeWordArray(stack);
+    utils::freeWordArray(result);
+    utils::freeWordArray(args);
+    utils::freeIntArray(scalarRegisters);
+    return mismatches;
+}
+
+int main() {
+    TestKernel kernels[3];
+    int kernelCount = 0;
+    kernels[kernelCount++] = {"scalar", 1, utils::executeProgramScalar};
+#ifdef CIRCUIT_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels[kernelCount++] = {"avx2", 4, utils::executeProgramAvx2};
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        kernels[kernelCount++] = {"avx512", 8, utils::executeProgramAvx512};
+    }
+#endif
+
+    RandomGenerator generator = makeRandomGenerator(TEST_SEED);
+    int failures = 0;
+    for (int p = 0; p < TEST_PROGRAM_COUNT; p++) {
+        const int argCount = 1 + nextRandomBelow(generator, 8);
+        Program program = generateProgram(generator, argCount);
+        for (int k = 0; k < kernelCount; k++) {
+            const int mismatches = compareKernel(kernels[k], program, argCount, generator);
+            if (mismatches > 0) {
+                std::cerr << "Kernel " << kernels[k].name << " differs from the interpreter on "
+                          << mismatches << " inputs of program " << p << ".\n";
+                failures++;
+            }
+        }
+        // Освобождаваме паметта
+        freeProgram(program);
+    }
+
+    std::cout << "Checked " << TEST_PROGRAM_COUNT << " programs on kernels:";
+    for (int k = 0; k < kernelCount; k++) {
+        std::cout << ' ' << kernels[k].name;
+    }
+    std::cout << (failures == 0 ? " - all match\n" : " - MISMATCHES FOUND\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,434 @@
+#pragma once
+
+// C++ system includes
+#include <algorithm>
+#include <cstdint>
+
+// Own includes
+#include "Utils.h"
+
+// Съдържа минимизацията на логически функции в дизюнктивна нормална форма (сума от произведения) -
+// точният алгоритъм на Куайн-МакКласки за малко входове и евристика в стила на Espresso за много
+
+// До колко входа се използва точната минимизация (простите импликанти се търсят сред всички 2^n входа)
+static constexpr auto QM_MAX_INPUTS = 12;
+// Максимален брой разгледани възли при точното покриване, след което се връща най-доброто намерено
+static constexpr auto QM_MAX_COVER_STEPS = 20000;
+// До колко входа забранените входове се пазят в побитова карта
+static constexpr auto OFF_BITMAP_MAX_INPUTS = 26;
+
+// Куб (произведение от литерали). Бит i от mask показва дали вход i участва, а бит i от value е
+// стойността му (0 - с отрицание)
+struct Cube {
+    std::uint64_t mask = 0;
+    std::uint64_t value = 0;
+};
+
+struct CubeVector {
+    Cube* data = nullptr;
+    int size = 0;
+    int capacity = 0;
+};
+
+// Съдържа входовете на функцията, на които тя е 1 (onSet) и 0 (offSet). Бит i от всеки вход е
+// стойността на i-тия аргумент. Входовете, които липсват и в двете множества, са безразлични
+struct MinimizeInput {
+    std::uint64_t* onSet = nullptr;
+    int onSize = 0;
+    std::uint64_t* offSet = nullptr;
+    int offSize = 0;
+    int inputCount = 0;
+};
+
+CubeVector makeCubeVector(const int capacity) {
+    CubeVector vector;
+    vector.data = new Cube[capacity];
+    vector.capacity = capacity;
+    return vector;
+}
+
+void clearCubeVector(CubeVector& vector) {
+    delete[] vector.data;
+    vector.data = nullptr;
+    vector.capacity = 0;
+    vector.size = 0;
+}
+
+void pushToCubeVector(CubeVector& vector, const Cube cube) {
+    if (vector.size == vector.capacity) {
+        const int newCapacity = vector.capacity > 0 ? vector.capacity * 2 : 16;
+        Cube* newData = new Cube[newCapacity];
+        for (int i = 0; i < vector.size; i++) {
+            newData[i] = vector.data[i];
+        }
+        delete[] vector.data;
+        vector.data = newData;
+        vector.capacity = newCapacity;
+    }
+    vector.data[vector.size++] = cube;
+}
+
+namespace utils {
+// Проверява дали кубът съдържа дадения вход
+bool cubeCovers(const Cube& cube, const std::uint64_t minterm) {
+    return ((minterm ^ cube.value) & cube.mask) == 0;
+}
+
+// Брой литерали в куба
+int countLiterals(const Cube& cube) { return __builtin_popcountll(cube.mask); }
+
+// Наредба на кубовете, използвана за сортиране и премахване на повторенията
+bool cubeLess(const Cube& a, const Cube& b) {
+    return a.mask != b.mask ? a.mask < b.mask : a.value < b.value;
+}
+
+// Проверява дали кубовете покриват точно единиците на функцията (и нито една от нулите й)
+bool coversFunction(const CubeVector& cover, const MinimizeInput& input) {
+    const auto coveredByAny = [&](const std::uint64_t minterm) {
+        for (int i = 0; i < cover.size; i++) {
+            if (cubeCovers(cover.data[i], minterm)) {
+                return true;
+            }
+        }
+        return false;
+    };
+    for (int i = 0; i < input.onSize; i++) {
+        if (!coveredByAny(input.onSet[i])) {
+            return false;
+        }
+    }
+    for (int i = 0; i < input.offSize; i++) {
+        if (coveredByAny(input.offSet[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+}  // namespace utils
+
+// Намира всички прости импликанти на функцията (Куайн-МакКласки). Безразличните входове участват в
+// слепването, а кубовете от всяко ниво се търсят двоично в сортирания списък на нивото
+CubeVector findPrimeImplicants(const MinimizeInput& input) {
+    const int n = input.inputCount;
+    const std::uint64_t fullMask = n == 64 ? ~0ULL : (1ULL << n) - 1;
+    const std::uint64_t rowCount = 1ULL << n;
+    // Входовете, на които функцията е 0, не участват в слепването
+    std::uint64_t* offBitmap = utils::allocWordArray((int)((rowCount + 63) / 64));
+    for (int i = 0; i < input.offSize; i++) {
+        offBitmap[input.offSet[i] / 64] |= 1ULL << (input.offSet[i] % 64);
+    }
+    CubeVector level = makeCubeVector((int)rowCount);
+    for (std::uint64_t m = 0; m < rowCount; m++) {
+        if (!((offBitmap[m / 64] >> (m % 64)) & 1)) {
+            pushToCubeVector(level, {fullMask, m});
+        }
+    }
+    utils::freeWordArray(offBitmap);
+
+    CubeVector primes = makeCubeVector(64);
+    while (level.size > 0) {
+        std::sort(level.data, level.data + level.size, utils::cubeLess);
+        bool* used = new bool[level.size]{};
+        CubeVector next = makeCubeVector(level.size + 1);
+        for (int i = 0; i < level.size; i++) {
+            const Cube& cube = level.data[i];
+            for (int v = 0; v < n; v++) {
+                const std::uint64_t bit = 1ULL << v;
+                if (!(cube.mask & bit) || (cube.value & bit)) {
+                    continue;
+                }
+                const Cube partner = {cube.mask, cube.value | bit};
+                const Cube* found = std::lower_bound(level.data, level.data + level.size, partner,
+                                                     utils::cubeLess);
+                if (found != level.data + level.size && found->mask == partner.mask &&
+                    found->value == partner.value) {
+                    used[i] = true;
+                    used[found - level.data] = true;
+                    pushToCubeVector(next, {cube.mask & ~bit, cube.value});
+                }
+            }
+        }
+        for (int i = 0; i < level.size; i++) {
+            if (!used[i]) {
+                pushToCubeVector(primes, level.data[i]);
+            }
+        }
+        // Премахваме повторенията в следващото ниво
+        std::sort(next.data, next.data + next.size, utils::cubeLess);
+        int uniqueSize = 0;
+        for (int i = 0; i < next.size; i++) {
+            if (uniqueSize == 0 || utils::cubeLess(next.data[uniqueSize - 1], next.data[i])) {
+                next.data[uniqueSize++] = next.data[i];
+            }
+        }
+        next.size = uniqueSize;
+        delete[] used;
+        clearCubeVector(level);
+        level = next;
+    }
+    clearCubeVector(level);
+    return primes;
+}
+
+// Състояние на търсенето на минимално покритие на единиците с прости импликанти
+struct CoverSearch {
+    const CubeVector* primes = nullptr;
+    std::uint64_t* coverSets = nullptr;  // Побитово множество на покритите единици за всеки импликант
+    int words = 0;                       // Брой думи на едно побитово множество
+    int onSize = 0;
+    int* chosen = nullptr;
+    int chosenSize = 0;
+    int* coverCount = nullptr;  // Брой импликанти, които покриват всяка единица
+    int* best = nullptr;
+    int bestSize = 0;
+    int bestLiterals = 0;
+    int steps = 0;
+};
+
+namespace utils {
+// Брой литерали на избраните импликанти
+int countChosenLiterals(const CoverSearch& search) {
+    int literals = 0;
+    for (int i = 0; i < search.chosenSize; i++) {
+        literals += countLiterals(search.primes->data[search.chosen[i]]);
+    }
+    return literals;
+}
+
+// Разклонение и ограничение - избира непокритата единица с най-малко покриващи я импликанти и
+// пробва всеки от тях. uncovered е побитовото множество на все още непокритите единици
+void searchCover(CoverSearch& search, const std::uint64_t* uncovered) {
+    if (++search.steps > QM_MAX_COVER_STEPS || search.chosenSize >= search.bestSize) {
+        return;
+    }
+    int pick = -1;
+    for (int m = 0; m < search.onSize; m++) {
+        if (((uncovered[m / 64] >> (m % 64)) & 1) &&
+            (pick == -1 || search.coverCount[m] < search.coverCount[pick])) {
+            pick = m;
+        }
+    }
+    if (pick == -1) {
+        // Всички единици са покрити - сравняваме с най-доброто решение досега
+        const int literals = countChosenLiterals(search);
+        if (search.chosenSize < search.bestSize ||
+            (search.chosenSize == search.bestSize && literals < search.bestLiterals)) {
+            for (int i = 0; i < search.chosenSize; i++) {
+                search.best[i] = search.chosen[i];
+            }
+            search.bestSize = search.chosenSize;
+            search.bestLiterals = literals;
+        }
+        return;
+    }
+    if (search.chosenSize + 1 >= search.bestSize) {
+        return;
+    }
+
+    std::uint64_t* rest = allocWordArray(search.words);
+    for (int p = 0; p < search.primes->size; p++) {
+        const std::uint64_t* set = search.coverSets + p * search.words;
+        if (!((set[pick / 64] >> (pick % 64)) & 1)) {
+            continue;
+        }
+        for (int w = 0; w < search.words; w++) {
+            rest[w] = uncovered[w] & ~set[w];
+        }
+        search.chosen[search.chosenSize++] = p;
+        searchCover(search, rest);
+        search.chosenSize--;
+    }
+    freeWordArray(rest);
+}
+}  // namespace utils
+
+// Точна минимизация (Куайн-МакКласки) - намира простите импликанти и избира най-малкото покритие
+// на единиците (първо по брой кубове, после по брой литерали)
+CubeVector minimizeExact(const MinimizeInput& input) {
+    CubeVector primes = findPrimeImplicants(input);
+    CubeVector result = makeCubeVector(primes.size + 1);
+    if (input.onSize == 0) {
+        clearCubeVector(primes);
+        return result;
+    }
+
+    CoverSearch search;
+    search.primes = &primes;
+    search.onSize = input.onSize;
+    search.words = (input.onSize + 63) / 64;
+    search.coverSets = utils::allocWordArray(primes.size * search.words);
+    for (int p = 0; p < primes.size; p++) {
+        for (int m = 0; m < input.onSize; m++) {
+            if (utils::cubeCovers(primes.data[p], input.onSet[m])) {
+                search.coverSets[p * search.words + m / 64] |= 1ULL << (m % 64);
+            }
+        }
+    }
+    search.coverCount = utils::allocIntArray(input.onSize);
+    for (int p = 0; p < primes.size; p++) {
+        for (int m = 0; m < input.onSize; m++) {
+            search.coverCount[m] += (search.coverSets[p * search.words + m / 64] >> (m % 64)) & 1;
+        }
+    }
+    search.chosen = utils::allocIntArray(primes.size + 1);
+    search.best = utils::allocIntArray(primes.size + 1);
+
+    // Алчно начално решение - винаги взимаме импликанта, който покрива най-много непокрити единици
+    std::uint64_t* uncovered = utils::allocWordArray(search.words);
+    for (int m = 0; m < input.onSize; m++) {
+        uncovered[m / 64] |= 1ULL << (m % 64);
+    }
+    std::uint64_t* rest = utils::allocWordArray(search.words);
+    for (int w = 0; w < search.words; w++) {
+        rest[w] = uncovered[w];
+    }
+    while (true) {
+        int bestPrime = -1;
+        int bestGain = 0;
+        for (int p = 0; p < primes.size; p++) {
+            int gain = 0;
+            for (int w = 0; w < search.words; w++) {
+                gain += __builtin_popcountll(rest[w] & search.coverSets[p * search.words + w]);
+            }
+            if (gain > bestGain) {
+                bestPrime = p;
+                bestGain = gain;
+            }
+        }
+        if (bestPrime == -1) {
+            break;
+        }
+        for (int w = 0; w < search.words; w++) {
+            rest[w] &= ~search.coverSets[bestPrime * search.words + w];
+        }
+        search.best[search.bestSize++] = bestPrime;
+    }
+    for (int i = 0; i < search.bestSize; i++) {
+        search.bestLiterals += utils::countLiterals(primes.data[search.best[i]]);
+    }
+    // Точно търсене, което подобрява алчното решение
+    utils::searchCover(search, uncovered);
+
+    for (int i = 0; i < search.bestSize; i++) {
+        pushToCubeVector(result, primes.data[search.best[i]]);
+    }
+    // Освобождаваме паметта
+    utils::freeWordArray(uncovered);
+    utils::freeWordArray(rest);
+    utils::freeWordArray(search.coverSets);
+    utils::freeIntArray(search.coverCount);
+    utils::freeIntArray(search.chosen);
+    utils::freeIntArray(search.best);
+    clearCubeVector(primes);
+    return result;
+}
+
+// Проверява дали кубът съдържа вход, на който функцията е 0. Ако забранените входове са в побитова
+// карта и кубът е по-малък от списъка им, се обхождат входовете на куба, иначе - списъкът
+bool cubeHitsOffSet(const Cube& cube, const MinimizeInput& input, const std::uint64_t* offBitmap) {
+    const int freeVars = input.inputCount - utils::countLiterals(cube);
+    if (offBitmap && freeVars < 31 && (1LL << freeVars) <= input.offSize) {
+        // Обхождаме всички подмножества на свободните входове
+        const std::uint64_t fullMask = (1ULL << input.inputCount) - 1;
+        const std::uint64_t freeMask = fullMask & ~cube.mask;
+        std::uint64_t sub = 0;
+        do {
+            const std::uint64_t minterm = cube.value | sub;
+            if ((offBitmap[minterm / 64] >> (minterm % 64)) & 1) {
+                return true;
+            }
+            sub = (sub - freeMask) & freeMask;
+        } while (sub != 0);
+        return false;
+    }
+    for (int i = 0; i < input.offSize; i++) {
+        if (utils::cubeCovers(cube, input.offSet[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Евристична минимизация в стила на Espresso. EXPAND разширява куба на всяка непокрита единица,
+// докато не започне да покрива нула, а IRREDUNDANT премахва кубовете, чиито единици са покрити от
+// другите кубове
+CubeVector minimizeHeuristic(const MinimizeInput& input) {
+    const int n = input.inputCount;
+    const std::uint64_t fullMask = n == 64 ? ~0ULL : (1ULL << n) - 1;
+    std::uint64_t* offBitmap = nullptr;
+    if (n <= OFF_BITMAP_MAX_INPUTS) {
+        offBitmap = utils::allocWordArray((int)(((1ULL << n) + 63) / 64));
+        for (int i = 0; i < input.offSize; i++) {
+            offBitmap[input.offSet[i] / 64] |= 1ULL << (input.offSet[i] % 64);
+        }
+    }
+
+    // EXPAND
+    CubeVector cover = makeCubeVector(64);
+    for (int m = 0; m < input.onSize; m++) {
+        const std::uint64_t minterm = input.onSet[m];
+        bool covered = false;
+        for (int c = cover.size - 1; c >= 0 && !covered; c--) {
+            covered = utils::cubeCovers(cover.data[c], minterm);
+        }
+        if (covered) {
+            continue;
+        }
+        Cube cube = {fullMask, minterm};
+        for (int v = 0; v < n; v++) {
+            const std::uint64_t bit = 1ULL << v;
+            // Новата половина на разширения куб е текущият куб с обърнат вход v
+            const Cube half = {cube.mask, cube.value ^ bit};
+            if (!cubeHitsOffSet(half, input, offBitmap)) {
+                cube = {cube.mask & ~bit, cube.value & ~bit};
+            }
+        }
+        pushToCubeVector(cover, cube);
+    }
+
+    // IRREDUNDANT - броим колко куба покриват всяка единица и премахваме излишните кубове, като
+    // започваме от тези с най-много литерали
+    int* coverCount = utils::allocIntArray(input.onSize + 1);
+    for (int m = 0; m < input.onSize; m++) {
+        for (int c = 0; c < cover.size; c++) {
+            coverCount[m] += utils::cubeCovers(cover.data[c], input.onSet[m]);
+        }
+    }
+    std::sort(cover.data, cover.data + cover.size, [](const Cube& a, const Cube& b) {
+        return utils::countLiterals(a) > utils::countLiterals(b);
+    });
+    CubeVector result = makeCubeVector(cover.size + 1);
+    for (int c = 0; c < cover.size; c++) {
+        const Cube& cube = cover.data[c];
+        bool redundant = true;
+        for (int m = 0; m < input.onSize && redundant; m++) {
+            redundant = !utils::cubeCovers(cube, input.onSet[m]) || coverCount[m] > 1;
+        }
+        if (!redundant) {
+            pushToCubeVector(result, cube);
+            continue;
+        }
+        for (int m = 0; m < input.onSize; m++) {
+            coverCount[m] -= utils::cubeCovers(cube, input.onSet[m]);
+        }
+    }
+
+    // Освобождаваме паметта
+    clearCubeVector(cover);
+    utils::freeIntArray(coverCount);
+    if (offBitmap) {
+        utils::freeWordArray(offBitmap);
+    }
+    return result;
+}
+
+// Минимизира функцията - точно за малко входове и евристично за много
+CubeVector minimizeFunction(const MinimizeInput& input) {
+    CubeVector result =
+        input.inputCount <= QM_MAX_INPUTS ? minimizeExact(input) : minimizeHeuristic(input);
+    assert(utils::coversFunction(result, input) && "Minimized function is not equivalent");
+    std::sort(result.data, result.data + result.size, [](const Cube& a, const Cube& b) {
+        return a.value != b.value ? a.value > b.value : a.mask > b.mask;
+    });
+    return result;
+}
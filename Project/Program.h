@@ -0,0 +1,355 @@
+#pragma once
+
+// C++ system includes
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CIRCUIT_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+// Own includes
+#include "Utils.h"
+
+// Съдържа компилираната програма на ис и ядрата, които я изпълняват
+
+// Код на инструкцията, която зарежда стойността на регистър (аргумент или временна стойност)
+static constexpr char OP_LOAD = '$';
+// Код на инструкцията, която премахва върха на стека и го записва във временен регистър
+static constexpr char OP_STORE = '#';
+// Код на инструкцията, която зарежда константа (стойността е в полето slot)
+static constexpr char OP_CONST = '%';
+
+// Брой редове от таблицата на истинност, които се пресмятат едновременно в една 64-битова дума
+static constexpr auto ROWS_PER_WORD = 64;
+
+// Инструкция от компилираната програма на ис
+struct Instruction {
+    char op = 0;    // OP_LOAD, OP_STORE, OP_CONST или някой от логическите оператори '!', '&', '|'
+    int slot = -1;  // Индекс на регистъра (OP_LOAD и OP_STORE) или стойността (OP_CONST)
+};
+
+// Компилиран логически израз в постфиксен запис, който реферира аргументите по индекс. Първите
+// регистри са аргументите на ис, а след тях са временните регистри на вградените подсхеми. Изход 0
+// остава на върха на стека, а при няколко изхода изход i се записва и в регистъра argCount + i
+struct Program {
+    Instruction* code = nullptr;
+    int size = 0;
+    int capacity = 0;
+    int registerCount = 0;
+    int outputCount = 1;
+    int maxDepth = 0;                      // Максималната дълбочина на стека при изпълнение
+    std::uint8_t* evalStack = nullptr;     // Заделен веднъж стек с maxDepth елемента за executeProgram
+};
+
+// Ядро, което изпълнява програмата побитово паралелно върху няколко последователни 64-битови думи
+// на всеки регистър (маските на регистър slot са в registers[slot * words, (slot + 1) * words),
+// като първите са аргументите, а стекът трябва да побира program.maxDepth * words думи)
+using SlicedKernel = void (*)(const Program& program, std::uint64_t* registers,
+                              std::uint64_t* stack, std::uint64_t* result);
+
+// Описва избраното ядро за побитово паралелно изпълнение
+struct SlicedBackend {
+    const char* name = "";
+    int words = 1;  // Брой 64-битови думи на аргумент, обработвани наведнъж
+    SlicedKernel kernel = nullptr;
+};
+
+namespace utils {
+// Изпълнява компилирана програма с дадените стойности на аргументите (registers трябва да побира
+// program.registerCount стойности, като първите са аргументите). Използва предварително заделения
+// стек на програмата, затова тя трябва да е подготвена с prepareProgramStack
+int executeProgram(const Program& program, int* registers) {
+    assert(program.evalStack && "Program stack is not prepared");
+    Stack exprStack;
+    exprStack.data = program.evalStack;
+    exprStack.capacity = program.maxDepth;
+    for (int i = 0; i < program.size; i++) {
+        const Instruction& instr = program.code[i];
+        switch (instr.op) {
+        case OP_LOAD:
+            pushToStack(exprStack, registers[instr.slot]);
+            break;
+        case OP_CONST:
+            pushToStack(exprStack, instr.slot);
+            break;
+        case OP_STORE:
+            registers[instr.slot] = peekStack(exprStack);
+            popFromStack(exprStack);
+            break;
+        case '!':
+            exprStack.data[exprStack.top] = !exprStack.data[exprStack.top];
+            break;
+        case '&': {
+            const int operand2 = peekStack(exprStack);
+            popFromStack(exprStack);
+            exprStack.data[exprStack.top] = exprStack.data[exprStack.top] && operand2;
+        } break;
+        case '|': {
+            const int operand2 = peekStack(exprStack);
+            popFromStack(exprStack);
+            exprStack.data[exprStack.top] = exprStack.data[exprStack.top] || operand2;
+        } break;
+        default:
+            std::cerr << "Unknown instruction found: " << instr.op << '\n';
+            assert(false);
+        }
+    }
+    assert(getStackSize(exprStack) == 1 && "Something is wrong");
+    return peekStack(exprStack);
+}
+
+// Изпълнява компилирана програма побитово паралелно - всеки аргумент е 64-битова маска, в която
+// всеки бит е стойността му за различен вход, а резултатът съдържа 64 реда от таблицата на истинност
+std::uint64_t executeProgramSliced(const Program& program, std::uint64_t* registers,
+                                   std::uint64_t* stack) {
+    int top = -1;
+    for (int i = 0; i < program.size; i++) {
+        const Instruction& instr = program.code[i];
+        switch (instr.op) {
+        case OP_LOAD:
+            stack[++top] = registers[instr.slot];
+            break;
+        case OP_CONST:
+            stack[++top] = instr.slot ? ~0ULL : 0ULL;
+            break;
+        case OP_STORE:
+            registers[instr.slot] = stack[top--];
+            break;
+        case '!':
+            stack[top] = ~stack[top];
+            break;
+        case '&':
+            stack[top - 1] &= stack[top];
+            top--;
+            break;
+        case '|':
+            stack[top - 1] |= stack[top];
+            top--;
+            break;
+        default:
+            std::cerr << "Unknown instruction found: " << instr.op << std::endl;
+            assert(false);
+        }
+    }
+    assert(top == 0 && "Something is wrong");
+    return stack[0];
+}
+
+// Попълва маските на аргументите за words * 64 реда на таблицата на истинност, започващи от
+// rowBase (първият аргумент е най-старшият бит на номера на реда). Маските на аргумент i са в
+// argMasks[i * words, (i + 1) * words)
+void fillRowMasks(std::uint64_t* argMasks, const int argCount, const std::uint64_t rowBase,
+                  const int words = 1) {
+    // Маски за младшите 6 бита на номера на реда в рамките на една дума
+    static constexpr std::uint64_t lowBitPatterns[] = {
+        0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+        0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL,
+    };
+    for (int i = 0; i < argCount; i++) {
+        const int bit = argCount - 1 - i;
+        for (int w = 0; w < words; w++) {
+            const std::uint64_t wordBase = rowBase + (std::uint64_t)w * ROWS_PER_WORD;
+            if (bit < 6) {
+                argMasks[i * words + w] = lowBitPatterns[bit];
+            } else {
+                argMasks[i * words + w] = ((wordBase >> bit) & 1) ? ~0ULL : 0ULL;
+            }
+        }
+    }
+}
+
+// Скаларно ядро - обработва по една 64-битова дума на аргумент
+void executeProgramScalar(const Program& program, std::uint64_t* registers, std::uint64_t* stack,
+                          std::uint64_t* result) {
+    result[0] = executeProgramSliced(program, registers, stack);
+}
+
+#ifdef CIRCUIT_X86_KERNELS
+// AVX2 ядро - обработва по 4 думи (256 реда) на аргумент с една инструкция. Върхът на стека се
+// държи в регистър, а останалите елементи са в stack
+__attribute__((target("avx2"))) void executeProgramAvx2(const Program& program,
+                                                        std::uint64_t* registers,
+                                                        std::uint64_t* stack,
+                                                        std::uint64_t* result) {
+    __m256i* vstack = reinterpret_cast<__m256i*>(stack);
+    __m256i* vregs = reinterpret_cast<__m256i*>(registers);
+    const __m256i ones = _mm256_set1_epi64x(-1);
+    __m256i acc = _mm256_setzero_si256();
+    int top = -1;
+    for (int i = 0; i < program.size; i++) {
+        const Instruction& instr = program.code[i];
+        switch (instr.op) {
+        case OP_LOAD:
+            if (top >= 0) {
+                _mm256_storeu_si256(&vstack[top], acc);
+            }
+            acc = _mm256_loadu_si256(&vregs[instr.slot]);
+            top++;
+            break;
+        case OP_CONST:
+            if (top >= 0) {
+                _mm256_storeu_si256(&vstack[top], acc);
+            }
+            acc = instr.slot ? ones : _mm256_setzero_si256();
+            top++;
+            break;
+        case OP_STORE:
+            _mm256_storeu_si256(&vregs[instr.slot], acc);
+            if (--top >= 0) {
+                acc = _mm256_loadu_si256(&vstack[top]);
+            }
+            break;
+        case '!':
+            acc = _mm256_xor_si256(acc, ones);
+            break;
+        case '&':
+            acc = _mm256_and_si256(_mm256_loadu_si256(&vstack[--top]), acc);
+            break;
+        case '|':
+            acc = _mm256_or_si256(_mm256_loadu_si256(&vstack[--top]), acc);
+            break;
+        default:
+            std::cerr << "Unknown instruction found: " << instr.op << std::endl;
+            assert(false);
+        }
+    }
+    assert(top == 0 && "Something is wrong");
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(result), acc);
+}
+
+// AVX-512 ядро - обработва по 8 думи (512 реда) на аргумент с една инструкция
+__attribute__((target("avx512f"))) void executeProgramAvx512(const Program& program,
+                                                             std::uint64_t* registers,
+                                                             std::uint64_t* stack,
+                                                             std::uint64_t* result) {
+    __m512i* vstack = reinterpret_cast<__m512i*>(stack);
+    __m512i* vregs = reinterpret_cast<__m512i*>(registers);
+    const __m512i ones = _mm512_set1_epi64(-1);
+    __m512i acc = _mm512_setzero_si512();
+    int top = -1;
+    for (int i = 0; i < program.size; i++) {
+        const Instruction& instr = program.code[i];
+        switch (instr.op) {
+        case OP_LOAD:
+            if (top >= 0) {
+                _mm512_storeu_si512(&vstack[top], acc);
+            }
+            acc = _mm512_loadu_si512(&vregs[instr.slot]);
+            top++;
+            break;
+        case OP_CONST:
+            if (top >= 0) {
+                _mm512_storeu_si512(&vstack[top], acc);
+            }
+            acc = instr.slot ? ones : _mm512_setzero_si512();
+            top++;
+            break;
+        case OP_STORE:
+            _mm512_storeu_si512(&vregs[instr.slot], acc);
+            if (--top >= 0) {
+                acc = _mm512_loadu_si512(&vstack[top]);
+            }
+            break;
+        case '!':
+            acc = _mm512_xor_si512(acc, ones);
+            break;
+        case '&':
+            acc = _mm512_and_si512(_mm512_loadu_si512(&vstack[--top]), acc);
+            break;
+        case '|':
+            acc = _mm512_or_si512(_mm512_loadu_si512(&vstack[--top]), acc);
+            break;
+        default:
+            std::cerr << "Unknown instruction found: " << instr.op << std::endl;
+            assert(false);
+        }
+    }
+    assert(top == 0 && "Something is wrong");
+    _mm512_storeu_si512(result, acc);
+}
+#endif
+
+// Избира най-широкото ядро, което процесорът поддържа. Чрез променливата на средата
+// CIRCUIT_KERNEL=scalar|avx2|avx512 може да се ограничи избора (напр. за сравнение на резултатите)
+SlicedBackend selectSlicedBackend() {
+    const char* limit = std::getenv("CIRCUIT_KERNEL");
+    const bool scalarOnly = limit && std::strcmp(limit, "scalar") == 0;
+    const bool allowAvx512 = !limit || std::strcmp(limit, "avx512") == 0;
+#ifdef CIRCUIT_X86_KERNELS
+    __builtin_cpu_init();
+    if (!scalarOnly && allowAvx512 && __builtin_cpu_supports("avx512f")) {
+        return {"avx512", 8, executeProgramAvx512};
+    }
+    if (!scalarOnly && __builtin_cpu_supports("avx2")) {
+        return {"avx2", 4, executeProgramAvx2};
+    }
+#endif
+    (void)scalarOnly;
+    (void)allowAvx512;
+    return {"scalar", 1, executeProgramScalar};
+}
+}  // namespace utils
+
+// Прави нова програма
+Program makeProgram(const int capacity) {
+    Program program;
+    program.code = new Instruction[capacity];
+    program.capacity = capacity;
+    return program;
+}
+
+// Освобождава паметта на дадената програма
+void freeProgram(Program& program) {
+    delete[] program.code;
+    program.code = nullptr;
+    program.capacity = 0;
+    program.size = 0;
+    delete[] program.evalStack;
+    program.evalStack = nullptr;
+    program.maxDepth = 0;
+    program.outputCount = 1;
+}
+
+// Пресмята максималната дълбочина на стека при изпълнение на програмата
+int computeMaxDepth(const Program& program) {
+    int depth = 0;
+    int maxDepth = 0;
+    for (int i = 0; i < program.size; i++) {
+        const char op = program.code[i].op;
+        if (op == OP_LOAD || op == OP_CONST) {
+            depth++;
+        } else if (op != '!') {
+            depth--;
+        }
+        maxDepth = depth > maxDepth ? depth : maxDepth;
+    }
+    return maxDepth;
+}
+
+// Пресмята дълбочината на стека на програмата и заделя стека за executeProgram
+void prepareProgramStack(Program& program) {
+    program.maxDepth = computeMaxDepth(program);
+    delete[] program.evalStack;
+    program.evalStack = new std::uint8_t[program.maxDepth > 0 ? program.maxDepth : 1]{};
+}
+
+// Добавя инструкция в края на програмата
+void pushToProgram(Program& program, const Instruction instr) {
+    if (program.size == program.capacity) {
+        const int newCapacity = program.capacity > 0 ? program.capacity * 2 : 16;
+        Instruction* newCode = new Instruction[newCapacity];
+        for (int i = 0; i < program.size; i++) {
+            newCode[i] = program.code[i];
+        }
+        delete[] program.code;
+        program.code = newCode;
+        program.capacity = newCapacity;
+    }
+    program.code[program.size++] = instr;
+}
+
+// Ядрото за побитово паралелно изпълнение, избрано при стартиране на програмата
+static const SlicedBackend slicedBackend = utils::selectSlicedBackend();
@@ -0,0 +1,235 @@
+#pragma once
+
+// C++ system includes
+#include <cstdint>
+
+// Own includes
+#include "Utils.h"
+
+// Съдържа кеша на резултатите от RUN. При ис с до RUN_CACHE_BITSET_MAX_INPUTS входа резултатите се
+// пазят в побитови множества с по един бит за всеки входен вектор (номерът му е като номера на реда
+// при ALL - първият вход е старшият бит), които RUN попълва при нужда, а ALL - наведнъж. При
+// по-широки ис те се пазят в ограничен LRU кеш с ключ побитово пакетираните входове
+
+// До колко входа резултатите се пазят в побитови множества (2^20 бита = 128 KiB на изход)
+static constexpr auto RUN_CACHE_BITSET_MAX_INPUTS = 20;
+// Брой записи в LRU кеша на по-широките ис (и брой кофи в хеш таблицата му)
+static constexpr auto RUN_CACHE_LRU_CAPACITY = 1 << 12;
+
+// Кеш на резултатите от RUN на една ис. Заделя се при първото използване (prepareRunCache)
+struct RunCache {
+    int argCount = 0;
+    int outputCount = 0;
+    // Побитовите множества - known отбелязва пресметнатите вектори, а изход k е в
+    // values[k * bitsetWords, (k + 1) * bitsetWords)
+    std::uint64_t* known = nullptr;
+    std::uint64_t* values = nullptr;
+    int bitsetWords = 0;
+    // LRU кешът - записът e има ключ keys[e * keyWords, (e + 1) * keyWords) (бит i е вход i) и
+    // изходи results[e * resultWords, (e + 1) * resultWords) (бит k е изход k). След последния
+    // запис в keys има още едно място за ключа, който се търси
+    std::uint64_t* keys = nullptr;
+    std::uint64_t* results = nullptr;
+    int keyWords = 0;
+    int resultWords = 0;
+    int size = 0;
+    int* newer = nullptr;    // По-скоро използваният съсед на записа в списъка (-1 за най-новия)
+    int* older = nullptr;    // По-отдавна използваният съсед на записа (-1 за най-стария)
+    int* chain = nullptr;    // Следващият запис в същата кофа на хеш таблицата (-1 за последния)
+    int* buckets = nullptr;  // Първият запис във всяка кофа (-1 за празна кофа)
+    int newest = -1;
+    int oldest = -1;
+};
+
+namespace utils {
+// Пресмята номера на входния вектор като ред от таблицата на истинност
+std::uint64_t getRunCacheRow(const int* args, const int argCount) {
+    std::uint64_t row = 0;
+    for (int i = 0; i < argCount; i++) {
+        row = (row << 1) | (std::uint64_t)args[i];
+    }
+    return row;
+}
+
+// Пакетира входовете в ключа на LRU кеша
+void packRunCacheKey(const RunCache& cache, const int* args, std::uint64_t* key) {
+    for (int w = 0; w < cache.keyWords; w++) {
+        key[w] = 0;
+    }
+    for (int i = 0; i < cache.argCount; i++) {
+        key[i / 64] |= (std::uint64_t)args[i] << (i % 64);
+    }
+}
+
+// Пресмята кофата на ключа в хеш таблицата на LRU кеша
+int getRunCacheBucket(const RunCache& cache, const std::uint64_t* key) {
+    std::uint64_t hash = (std::uint64_t)cache.argCount;
+    for (int w = 0; w < cache.keyWords; w++) {
+        hash = (hash ^ key[w]) * 0x9E3779B97F4A7C15ULL;
+    }
+    return (int)((hash ^ (hash >> 29)) & (RUN_CACHE_LRU_CAPACITY - 1));
+}
+
+// Премахва записа от списъка по време на използване
+void unlinkRunCacheEntry(RunCache& cache, const int entry) {
+    (cache.newer[entry] != -1 ? cache.older[cache.newer[entry]] : cache.newest) =
+        cache.older[entry];
+    (cache.older[entry] != -1 ? cache.newer[cache.older[entry]] : cache.oldest) =
+        cache.newer[entry];
+}
+
+// Добавя записа като най-скоро използван
+void pushNewestRunCacheEntry(RunCache& cache, const int entry) {
+    cache.newer[entry] = -1;
+    cache.older[entry] = cache.newest;
+    (cache.newest != -1 ? cache.newer[cache.newest] : cache.oldest) = entry;
+    cache.newest = entry;
+}
+
+// Премахва записа от кофата му в хеш таблицата
+void unchainRunCacheEntry(RunCache& cache, const int entry) {
+    int* link = &cache.buckets[getRunCacheBucket(cache, cache.keys + entry * cache.keyWords)];
+    while (*link != entry) {
+        link = &cache.chain[*link];
+    }
+    *link = cache.chain[entry];
+}
+
+// Намира записа с дадения ключ в LRU кеша. Връща -1, ако няма такъв
+int findRunCacheEntry(const RunCache& cache, const std::uint64_t* key, const int bucket) {
+    for (int entry = cache.buckets[bucket]; entry != -1; entry = cache.chain[entry]) {
+        const std::uint64_t* entryKey = cache.keys + entry * cache.keyWords;
+        bool equal = true;
+        for (int w = 0; equal && w < cache.keyWords; w++) {
+            equal = entryKey[w] == key[w];
+        }
+        if (equal) {
+            return entry;
+        }
+    }
+    return -1;
+}
+}  // namespace utils
+
+// Заделя паметта на кеша за ис с дадения брой входове и изходи (ако все още не е заделена)
+void prepareRunCache(RunCache& cache, const int argCount, const int outputCount) {
+    if (cache.known || cache.keys) {
+        return;
+    }
+    cache.argCount = argCount;
+    cache.outputCount = outputCount;
+    if (argCount <= RUN_CACHE_BITSET_MAX_INPUTS) {
+        cache.bitsetWords = (int)(((1ULL << argCount) + 63) / 64);
+        cache.known = utils::allocWordArray(cache.bitsetWords);
+        cache.values = utils::allocWordArray(cache.bitsetWords * outputCount);
+        return;
+    }
+    cache.keyWords = (argCount + 63) / 64;
+    cache.resultWords = (outputCount + 63) / 64;
+    cache.keys = utils::allocWordArray((RUN_CACHE_LRU_CAPACITY + 1) * cache.keyWords);
+    cache.results = utils::allocWordArray(RUN_CACHE_LRU_CAPACITY * cache.resultWords);
+    cache.newer = utils::allocIntArray(RUN_CACHE_LRU_CAPACITY);
+    cache.older = utils::allocIntArray(RUN_CACHE_LRU_CAPACITY);
+    cache.chain = utils::allocIntArray(RUN_CACHE_LRU_CAPACITY);
+    cache.buckets = utils::allocIntArray(RUN_CACHE_LRU_CAPACITY);
+    for (int i = 0; i < RUN_CACHE_LRU_CAPACITY; i++) {
+        cache.buckets[i] = -1;
+    }
+}
+
+// Освобождава паметта на кеша
+void freeRunCache(RunCache& cache) {
+    utils::freeWordArray(cache.known);
+    utils::freeWordArray(cache.values);
+    utils::freeWordArray(cache.keys);
+    utils::freeWordArray(cache.results);
+    utils::freeIntArray(cache.newer);
+    utils::freeIntArray(cache.older);
+    utils::freeIntArray(cache.chain);
+    utils::freeIntArray(cache.buckets);
+    cache = RunCache();
+}
+
+// Търси резултата за даден вход (стойностите на входовете трябва да са 0 или 1). При попадение
+// записва изходите в outputs и връща true
+bool lookupRunCache(RunCache& cache, const int* args, int* outputs) {
+    if (cache.known) {
+        const std::uint64_t row = utils::getRunCacheRow(args, cache.argCount);
+        if (!((cache.known[row / 64] >> (row % 64)) & 1)) {
+            return false;
+        }
+        for (int k = 0; k < cache.outputCount; k++) {
+            outputs[k] = (int)((cache.values[k * cache.bitsetWords + row / 64] >> (row % 64)) & 1);
+        }
+        return true;
+    }
+
+    std::uint64_t* key = cache.keys + RUN_CACHE_LRU_CAPACITY * cache.keyWords;
+    utils::packRunCacheKey(cache, args, key);
+    const int entry = utils::findRunCacheEntry(cache, key, utils::getRunCacheBucket(cache, key));
+    if (entry == -1) {
+        return false;
+    }
+    const std::uint64_t* result = cache.results + entry * cache.resultWords;
+    for (int k = 0; k < cache.outputCount; k++) {
+        outputs[k] = (int)((result[k / 64] >> (k % 64)) & 1);
+    }
+    // Записът става най-скоро използван
+    utils::unlinkRunCacheEntry(cache, entry);
+    utils::pushNewestRunCacheEntry(cache, entry);
+    return true;
+}
+
+// Записва резултата за даден вход. В LRU кеша при липса на място се премахва най-отдавна
+// използваният запис
+void storeRunCache(RunCache& cache, const int* args, const int* outputs) {
+    if (cache.known) {
+        const std::uint64_t row = utils::getRunCacheRow(args, cache.argCount);
+        const std::uint64_t bit = 1ULL << (row % 64);
+        cache.known[row / 64] |= bit;
+        for (int k = 0; k < cache.outputCount; k++) {
+            std::uint64_t& word = cache.values[k * cache.bitsetWords + row / 64];
+            word = outputs[k] ? word | bit : word & ~bit;
+        }
+        return;
+    }
+
+    int entry = cache.size;
+    if (cache.size < RUN_CACHE_LRU_CAPACITY) {
+        cache.size++;
+    } else {
+        entry = cache.oldest;
+        utils::unlinkRunCacheEntry(cache, entry);
+        utils::unchainRunCacheEntry(cache, entry);
+    }
+    std::uint64_t* key = cache.keys + entry * cache.keyWords;
+    utils::packRunCacheKey(cache, args, key);
+    std::uint64_t* result = cache.results + entry * cache.resultWords;
+    for (int w = 0; w < cache.resultWords; w++) {
+        result[w] = 0;
+    }
+    for (int k = 0; k < cache.outputCount; k++) {
+        result[k / 64] |= (std::uint64_t)(outputs[k] & 1) << (k % 64);
+    }
+    const int bucket = utils::getRunCacheBucket(cache, key);
+    cache.chain[entry] = cache.buckets[bucket];
+    cache.buckets[bucket] = entry;
+    utils::pushNewestRunCacheEntry(cache, entry);
+}
+
+// Записва резултатите от побитово паралелно изпълнение на редовете [rowBase, rowEnd) в побитовите
+// множества (изход k е в res[k * words, (k + 1) * words)). rowBase трябва да е кратно на 64.
+// Различни нишки могат да записват едновременно редове от различни думи
+void storeRunCacheRows(const RunCache& cache, const std::uint64_t rowBase,
+                       const std::uint64_t rowEnd, const std::uint64_t* res, const int words) {
+    for (int w = 0; w < words && rowBase + (std::uint64_t)w * 64 < rowEnd; w++) {
+        const std::uint64_t wordIndex = rowBase / 64 + w;
+        const std::uint64_t lanes = rowEnd - (rowBase + (std::uint64_t)w * 64);
+        const std::uint64_t mask = lanes >= 64 ? ~0ULL : (1ULL << lanes) - 1;
+        cache.known[wordIndex] |= mask;
+        for (int k = 0; k < cache.outputCount; k++) {
+            std::uint64_t& word = cache.values[k * cache.bitsetWords + wordIndex];
+            word = (word & ~mask) | (res[k * words + w] & mask);
+        }
+    }
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+// C++ system includes
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+// Own includes
+#include "Utils.h"
+
+// Съдържа статистиката на сесията (--stats и командата STATS) - брой изпълнения, хистограма на
+// времето за изпълнение и заделената памет за всеки вид команда, както и попаденията в кешовете
+
+// Видовете команди, за които се води статистика. Последният вид са непознатите команди
+static constexpr const char* COMMAND_NAMES[] = {
+    "DEFINE", "RUN",  "RUNFILE", "ALL",  "RANDOM", "COMPILE", "SIM",  "EQUIV",
+    "SAT",    "SAVE", "LOAD",    "FIND", "PRINT",  "STATS",   "OTHER"};
+static constexpr auto COMMAND_KIND_COUNT = (int)(sizeof(COMMAND_NAMES) / sizeof(const char*));
+// Брой под-кофи на всяка степен на 2 в хистограмата (относителната грешка е под 1/8)
+static constexpr auto LATENCY_SUB_BUCKETS = 8;
+// Брой кофи в хистограмата - стигат за всички 64-битови времена в наносекунди
+static constexpr auto LATENCY_BUCKETS = 64 * LATENCY_SUB_BUCKETS;
+
+// Хистограма на времената за изпълнение в наносекунди. Стойностите под LATENCY_SUB_BUCKETS имат
+// собствена кофа, а всяка следваща степен на 2 е разделена на LATENCY_SUB_BUCKETS равни кофи
+struct LatencyHistogram {
+    std::uint64_t buckets[LATENCY_BUCKETS] = {};
+    std::uint64_t count = 0;
+    std::uint64_t maxNs = 0;
+};
+
+// Статистика за един вид команда
+struct CommandStats {
+    std::uint64_t allocatedBytes = 0;  // Заделена памет чрез помощните функции от Utils.h
+    LatencyHistogram latency;
+};
+
+// Попадения и пропуски в кешовете на симулатора
+struct CacheCounters {
+    std::uint64_t lookupHits = 0;    // Намерени ис в хранилището по име
+    std::uint64_t lookupMisses = 0;  // Търсени, но несъществуващи ис
+    std::uint64_t nativeHits = 0;    // Нативен код, зареден направо от директорията с библиотеки
+    std::uint64_t nativeMisses = 0;  // Нативен код, който е трябвало да се компилира
+    std::uint64_t runHits = 0;       // Резултати от RUN, взети от кеша на ис
+    std::uint64_t runMisses = 0;     // Резултати от RUN, които е трябвало да се пресметнат
+};
+
+// Статистика на сесията. Води се само ако enabled е true (--stats или след първата команда STATS)
+struct SessionStats {
+    bool enabled = false;
+    CommandStats commands[COMMAND_KIND_COUNT];
+};
+
+// Броячите на кешовете се увеличават от самите кешове, затова са общи за програмата
+static CacheCounters cacheCounters;
+
+namespace utils {
+// Връща кофата от хистограмата, в която попада времето
+int getLatencyBucket(const std::uint64_t ns) {
+    if (ns < LATENCY_SUB_BUCKETS) {
+        return (int)ns;
+    }
+    // Старшият бит определя степента на 2, а следващите 3 бита - под-кофата в нея
+    const int exponent = 63 - __builtin_clzll(ns);
+    const int subBucket = (int)((ns >> (exponent - 3)) & (LATENCY_SUB_BUCKETS - 1));
+    return (exponent - 2) * LATENCY_SUB_BUCKETS + subBucket;
+}
+
+// Връща горната граница на времената в дадена кофа от хистограмата
+std::uint64_t getLatencyBucketLimit(const int bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) {
+        return (std::uint64_t)bucket;
+    }
+    const int exponent = bucket / LATENCY_SUB_BUCKETS + 2;
+    const std::uint64_t subBucket = (std::uint64_t)(bucket % LATENCY_SUB_BUCKETS);
+    return ((LATENCY_SUB_BUCKETS + subBucket + 1) << (exponent - 3)) - 1;
+}
+
+// Връща (приблизително) времето, под което са дадения процент от изпълненията
+std::uint64_t getLatencyPercentile(const LatencyHistogram& histogram, const double percent) {
+    std::uint64_t rank = (std::uint64_t)(histogram.count * percent / 100.0 + 0.5);
+    rank = rank > 0 ? rank : 1;
+    std::uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += histogram.buckets[i];
+        if (seen >= rank) {
+            // Горната граница на кофата може да надвиши най-голямото време
+            const std::uint64_t limit = getLatencyBucketLimit(i);
+            return limit < histogram.maxNs ? limit : histogram.maxNs;
+        }
+    }
+    return histogram.maxNs;
+}
+}  // namespace utils
+
+// Връща вида на командата на даден ред (по първата дума от него)
+int getCommandKind(const std::string& line) {
+    std::size_t begin = 0;
+    while (begin < line.size() && std::isspace((unsigned char)line[begin])) {
+        begin++;
+    }
+    std::size_t end = begin;
+    while (end < line.size() && !std::isspace((unsigned char)line[end])) {
+        end++;
+    }
+    for (int kind = 0; kind < COMMAND_KIND_COUNT - 1; kind++) {
+        if (line.compare(begin, end - begin, COMMAND_NAMES[kind]) == 0) {
+            return kind;
+        }
+    }
+    return COMMAND_KIND_COUNT - 1;
+}
+
+// Записва едно изпълнение на команда от даден вид
+void recordCommand(SessionStats& stats, const int kind, const std::uint64_t ns,
+                   const std::uint64_t allocatedBytes) {
+    CommandStats& command = stats.commands[kind];
+    command.allocatedBytes += allocatedBytes;
+    command.latency.buckets[utils::getLatencyBucket(ns)]++;
+    command.latency.count++;
+    command.latency.maxNs = ns > command.latency.maxNs ? ns : command.latency.maxNs;
+}
+
+// Нулира статистиката на сесията и броячите на кешовете
+void resetSessionStats(SessionStats& stats) {
+    for (int kind = 0; kind < COMMAND_KIND_COUNT; kind++) {
+        stats.commands[kind] = CommandStats();
+    }
+    cacheCounters = CacheCounters();
+}
+
+// Принтира статистиката на сесията - по един ред за всеки изпълняван вид команда (времената са в
+// милисекунди) и попаденията в кешовете
+void printSessionStats(const SessionStats& stats, std::ostream& out) {
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-8s %10s %12s %12s %12s %16s\n", "Command", "Count",
+                  "p50 ms", "p99 ms", "max ms", "Alloc bytes");
+    out << line;
+    for (int kind = 0; kind < COMMAND_KIND_COUNT; kind++) {
+        const CommandStats& command = stats.commands[kind];
+        if (command.latency.count == 0) {
+            continue;
+        }
+        std::snprintf(line, sizeof(line), "%-8s %10llu %12.3f %12.3f %12.3f %16llu\n",
+                      COMMAND_NAMES[kind], (unsigned long long)command.latency.count,
+                      utils::getLatencyPercentile(command.latency, 50) / 1e6,
+                      utils::getLatencyPercentile(command.latency, 99) / 1e6,
+                      command.latency.maxNs / 1e6, (unsigned long long)command.allocatedBytes);
+        out << line;
+    }
+    out << "Circuit lookups: " << cacheCounters.lookupHits << " hits, "
+        << cacheCounters.lookupMisses << " misses\n";
+    out << "Native code cache: " << cacheCounters.nativeHits << " hits, "
+        << cacheCounters.nativeMisses << " misses\n";
+    out << "RUN result cache: " << cacheCounters.runHits << " hits, " << cacheCounters.runMisses
+        << " misses\n";
+}
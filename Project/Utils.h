@@ -1,45 +1,162 @@
+#pragma once
+
+#include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <string>
+#include <utility>
 
 // Съдържа полезни структури и функции за работа с динамична памет
 
-static constexpr auto MAX_STACK_SIZE = 100;
+// До колко входа таблицата на истинност може да извлича входовете от номера на реда
+static constexpr auto MAX_IMPLIED_INPUTS = 30;
+
+// Общ брой байтове, заделени чрез allocIntArray, allocCharArray и allocWordArray (за статистиката
+// на сесията). Помощните функции се извикват и от нишките на ALL, затова броячът е атомарен
+static std::atomic<std::uint64_t> allocatedBytes{0};
+
+// Линеен (bump) алокатор - паметта се взима последователно от един предварително заделен блок и се
+// освобождава наведнъж с resetArena
+struct Arena {
+    char* data = nullptr;
+    std::size_t size = 0;  // Заетата част от блока
+    std::size_t capacity = 0;
+};
 
+// Векторите с arena != nullptr държат данните си в съответния алокатор вместо в хийпа
 struct CharVector {
     char* data = nullptr;
     int size = 0;
     int capacity = 0;
+    Arena* arena = nullptr;
 };
 
 struct IntVector {
     int* data = nullptr;
     int size = 0;
     int capacity = 0;
+    Arena* arena = nullptr;
 };
 
+struct StringVector {
+    std::string* data = nullptr;
+    int size = 0;
+    int capacity = 0;
+};
+
+// Стек за изпълнение на логически израз с байтови елементи. Капацитетът се задава предварително
+// (максималната дълбочина на израза), затова операциите проверяват границите само с assert
 struct Stack {
-    int data[MAX_STACK_SIZE]{};
+    std::uint8_t* data = nullptr;
     int top = -1;
+    int capacity = 0;
 };
 
+// Таблица на истинност с по един бит за клетка. Изходите (последните outputCount колони) се пазят
+// като побитови множества по редове - изход k заема (capacity + 63) / 64 думи, започващи от
+// outputs + k * (capacity + 63) / 64. Докато редовете следват реда на пълната таблица (входовете
+// на ред i са числото i в двоичен запис с първия вход като старши бит), входовете се извличат от
+// номера на реда и не се пазят. Иначе всеки ред заема rowWords думи в data, а бит j от тях е
+// стойността на вход j
 struct TruthTable {
-    int* data = nullptr;
-    int size = 0;
-    int capacity = 0;
+    std::uint64_t* data = nullptr;
+    std::uint64_t* outputs = nullptr;
     int rows = 0;
     int cols = 0;
+    int outputCount = 1;
+    int rowWords = 0;
+    int capacity = 0;  // Брой редове, за които има заделена памет
+    bool impliedInputs = true;
+};
+
+// Генератор на псевдослучайни 64-битови думи (xoshiro256**)
+struct RandomGenerator {
+    std::uint64_t state[4] = {};
 };
 
 namespace utils {
+// Връща следващата стойност на splitmix64 - използва се за разпръскване на началното число
+std::uint64_t nextSplitMix(std::uint64_t& x) {
+    std::uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Връща следващата псевдослучайна дума - всеки бит е 0 или 1 с вероятност 1/2
+std::uint64_t nextRandomWord(RandomGenerator& generator) {
+    std::uint64_t* s = generator.state;
+    const std::uint64_t x = s[1] * 5;
+    const std::uint64_t result = ((x << 7) | (x >> 57)) * 9;
+    const std::uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+}
+
+// Размерът на заявка към алокатора, закръглен така, че всички заявки да са подравнени
+std::size_t alignArenaSize(const std::size_t bytes) {
+    constexpr std::size_t alignment = alignof(std::max_align_t);
+    return (bytes + alignment - 1) & ~(alignment - 1);
+}
+
+// Взима нулирана памет от алокатора. Връща nullptr, ако в блока няма достатъчно място
+void* allocFromArena(Arena& arena, const std::size_t bytes) {
+    const std::size_t alignedBytes = alignArenaSize(bytes);
+    if (alignedBytes > arena.capacity - arena.size) {
+        return nullptr;
+    }
+    void* ptr = arena.data + arena.size;
+    arena.size += alignedBytes;
+    std::memset(ptr, 0, alignedBytes);
+    return ptr;
+}
+
+// Разширява на място последната заявка към алокатора. Връща false, ако тя не е последна или няма място
+bool growInArena(Arena& arena, void* ptr, const std::size_t oldBytes, const std::size_t newBytes) {
+    const std::size_t oldAligned = alignArenaSize(oldBytes);
+    const std::size_t newAligned = alignArenaSize(newBytes);
+    if ((char*)ptr + oldAligned != arena.data + arena.size ||
+        newAligned - oldAligned > arena.capacity - arena.size) {
+        return false;
+    }
+    std::memset(arena.data + arena.size, 0, newAligned - oldAligned);
+    arena.size += newAligned - oldAligned;
+    return true;
+}
+
+// Връща паметта на заявката в алокатора, ако тя е последна (иначе се освобождава при resetArena)
+void releaseToArena(Arena& arena, void* ptr, const std::size_t bytes) {
+    if ((char*)ptr + alignArenaSize(bytes) == arena.data + arena.size) {
+        arena.size = (std::size_t)((char*)ptr - arena.data);
+    }
+}
+
 int* allocIntArray(const int arrSize) {
     int* arr = new (std::nothrow) int[arrSize]{};
     assert(arr && "Failed to allocate memory");
+    allocatedBytes.fetch_add(sizeof(int) * arrSize, std::memory_order_relaxed);
     return arr;
 }
 
 char* allocCharArray(const int arrSize) {
     char* arr = new (std::nothrow) char[arrSize]{};
     assert(arr && "Failed to allocate memory");
+    allocatedBytes.fetch_add(sizeof(char) * arrSize, std::memory_order_relaxed);
+    return arr;
+}
+
+std::uint64_t* allocWordArray(const int arrSize) {
+    std::uint64_t* arr = new (std::nothrow) std::uint64_t[arrSize]{};
+    assert(arr && "Failed to allocate memory");
+    allocatedBytes.fetch_add(sizeof(std::uint64_t) * arrSize, std::memory_order_relaxed);
     return arr;
 }
 
@@ -53,6 +170,11 @@ void freeCharArray(char*& arr) {
     arr = nullptr;
 }
 
+void freeWordArray(std::uint64_t*& arr) {
+    delete[] arr;
+    arr = nullptr;
+}
+
 void printCharVector(const CharVector& vector) {
     for (int i = 0; i < vector.size; i++) {
         std::cout << vector.data[i] << " ";
@@ -60,6 +182,13 @@ void printCharVector(const CharVector& vector) {
     std::cout << std::endl;
 }
 
+void printStringVector(const StringVector& vector) {
+    for (int i = 0; i < vector.size; i++) {
+        std::cout << vector.data[i] << " ";
+    }
+    std::cout << std::endl;
+}
+
 void printIntVector(const IntVector& vector) {
     for (int i = 0; i < vector.size; i++) {
         std::cout << vector.data[i] << " ";
@@ -71,62 +200,248 @@ void reallocIntVector(IntVector& vector, const int newCapacity) {
     if (vector.capacity > newCapacity) {
         return;
     }
+    // В алокатора векторът расте на място, ако е последната заявка в него
+    if (vector.arena && growInArena(*vector.arena, vector.data, sizeof(int) * vector.capacity,
+                                    sizeof(int) * newCapacity)) {
+        vector.capacity = newCapacity;
+        return;
+    }
 
-    int* newData = allocIntArray(newCapacity);
+    int* newData = vector.arena ? (int*)allocFromArena(*vector.arena, sizeof(int) * newCapacity)
+                                : nullptr;
+    Arena* newArena = newData ? vector.arena : nullptr;
+    newData = newData ? newData : allocIntArray(newCapacity);
     for (int i = 0; i < vector.size; i++) {
         newData[i] = vector.data[i];
     }
-    freeIntArray(vector.data);
+    if (!vector.arena) {
+        freeIntArray(vector.data);
+    }
     vector.data = newData;
     vector.capacity = newCapacity;
+    vector.arena = newArena;
 }
 
 void reallocCharVector(CharVector& vector, const int newCapacity) {
     if (vector.capacity > newCapacity) {
         return;
     }
+    // В алокатора векторът расте на място, ако е последната заявка в него
+    if (vector.arena &&
+        growInArena(*vector.arena, vector.data, vector.capacity, newCapacity)) {
+        vector.capacity = newCapacity;
+        return;
+    }
 
-    char* newData = allocCharArray(newCapacity);
+    char* newData = vector.arena ? (char*)allocFromArena(*vector.arena, newCapacity) : nullptr;
+    Arena* newArena = newData ? vector.arena : nullptr;
+    newData = newData ? newData : allocCharArray(newCapacity);
     for (int i = 0; i < vector.size; i++) {
         newData[i] = vector.data[i];
     }
-    freeCharArray(vector.data);
+    if (!vector.arena) {
+        freeCharArray(vector.data);
+    }
+    vector.data = newData;
+    vector.capacity = newCapacity;
+    vector.arena = newArena;
+}
+
+void reallocStringVector(StringVector& vector, const int newCapacity) {
+    if (vector.capacity > newCapacity) {
+        return;
+    }
+
+    std::string* newData = new std::string[newCapacity];
+    for (int i = 0; i < vector.size; i++) {
+        newData[i] = std::move(vector.data[i]);
+    }
+    delete[] vector.data;
     vector.data = newData;
     vector.capacity = newCapacity;
 }
 
+// Връща входовете на ред с даден номер от пълната таблица - бит j е стойността на вход j (номерът на
+// реда, записан с обърнат ред на битовете)
+std::uint64_t getImpliedInputs(const int row, const int inputCount) {
+    if (inputCount == 0) {
+        return 0;
+    }
+    std::uint64_t x = (std::uint64_t)row;
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    x = ((x >> 8) & 0x00FF00FF00FF00FFULL) | ((x & 0x00FF00FF00FF00FFULL) << 8);
+    x = ((x >> 16) & 0x0000FFFF0000FFFFULL) | ((x & 0x0000FFFF0000FFFFULL) << 16);
+    x = (x >> 32) | (x << 32);
+    return x >> (64 - inputCount);
+}
+
+// Връща броя входове (колоните без изходите) на таблицата на истинност
+int getTruthTableInputCount(const TruthTable& table) { return table.cols - table.outputCount; }
+
+// Връща побитовото множество на даден изход на таблицата на истинност
+const std::uint64_t* getTruthTableOutput(const TruthTable& table, const int output) {
+    return table.outputs + output * ((table.capacity + 63) / 64);
+}
+
+// Връща стойността в дадена клетка на таблицата на истинност
+int getTruthTableCell(const TruthTable& table, const int row, const int col) {
+    const int inputCount = getTruthTableInputCount(table);
+    if (col >= inputCount) {
+        return (int)((getTruthTableOutput(table, col - inputCount)[row / 64] >> (row % 64)) & 1);
+    }
+    if (table.impliedInputs) {
+        return (row >> (inputCount - 1 - col)) & 1;
+    }
+    return (int)((table.data[row * table.rowWords + col / 64] >> (col % 64)) & 1);
+}
+
+// Връща входовете на даден ред (за таблици с до 64 входа) - бит j е стойността на вход j
+std::uint64_t getTruthTableInputs(const TruthTable& table, const int row) {
+    if (table.impliedInputs) {
+        return getImpliedInputs(row, getTruthTableInputCount(table));
+    }
+    return table.rowWords > 0 ? table.data[row * table.rowWords] : 0;
+}
+
+// Попълва изгледа по колони за 64 реда от rowBase нататък (rowBase е кратно на 64) - бит b от
+// columns[j] е стойността в колона j на ред rowBase + b. Редовете след края на таблицата са 0
+void fillTruthTableColumns(const TruthTable& table, const int rowBase, std::uint64_t* columns) {
+    // Стойностите на младшите 6 бита от номера на реда за 64 поредни реда
+    static constexpr std::uint64_t lowBitPatterns[6] = {
+        0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+        0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL};
+    const int inputCount = getTruthTableInputCount(table);
+    const int rowCount = table.rows - rowBase < 64 ? table.rows - rowBase : 64;
+    const std::uint64_t validMask = rowCount == 64 ? ~0ULL : (1ULL << rowCount) - 1;
+    for (int j = 0; j < table.cols; j++) {
+        columns[j] = 0;
+    }
+    if (table.impliedInputs) {
+        for (int j = 0; j < inputCount; j++) {
+            const int bit = inputCount - 1 - j;
+            const std::uint64_t pattern =
+                bit < 6 ? lowBitPatterns[bit] : (((rowBase >> bit) & 1) ? ~0ULL : 0);
+            columns[j] = pattern & validMask;
+        }
+    } else {
+        for (int b = 0; b < rowCount; b++) {
+            const std::uint64_t* row = table.data + (rowBase + b) * table.rowWords;
+            for (int w = 0; w < table.rowWords; w++) {
+                for (std::uint64_t bits = row[w]; bits; bits &= bits - 1) {
+                    columns[w * 64 + __builtin_ctzll(bits)] |= 1ULL << b;
+                }
+            }
+        }
+    }
+    for (int k = 0; k < table.outputCount; k++) {
+        columns[inputCount + k] = getTruthTableOutput(table, k)[rowBase / 64] & validMask;
+    }
+}
+
+// Принтира таблицата по 64 реда наведнъж през изгледа й по колони
 void printTruthTable(const TruthTable& table) {
-    for (int i = 0; i < table.rows; i++) {
-        for (int j = 0; j < table.cols; j++) {
-            std::cout << table.data[i * table.cols + j] << " ";
+    std::uint64_t* columns = allocWordArray(table.cols);
+    std::string block;
+    for (int rowBase = 0; rowBase < table.rows; rowBase += 64) {
+        fillTruthTableColumns(table, rowBase, columns);
+        block.clear();
+        for (int b = 0; b < 64 && rowBase + b < table.rows; b++) {
+            for (int j = 0; j < table.cols; j++) {
+                block += (char)('0' + ((columns[j] >> b) & 1));
+                block += ' ';
+            }
+            block += '\n';
         }
-        std::cout << std::endl;
+        std::cout.write(block.data(), block.size());
     }
+    std::cout.flush();
+    // Освобождаваме паметта
+    freeWordArray(columns);
 }
 }  // namespace utils
 
-IntVector makeIntVector(const int capacity) {
+// Прави генератор на псевдослучайни думи с дадено начално число
+RandomGenerator makeRandomGenerator(std::uint64_t seed) {
+    RandomGenerator generator;
+    for (int i = 0; i < 4; i++) {
+        generator.state[i] = utils::nextSplitMix(seed);
+    }
+    return generator;
+}
+
+Arena makeArena(const std::size_t capacity) {
+    Arena arena;
+    arena.data = new (std::nothrow) char[capacity];
+    assert(arena.data && "Failed to allocate memory");
+    arena.capacity = capacity;
+    return arena;
+}
+
+void freeArena(Arena& arena) {
+    delete[] arena.data;
+    arena.data = nullptr;
+    arena.capacity = 0;
+    arena.size = 0;
+}
+
+// Освобождава наведнъж всичко, заделено в алокатора
+void resetArena(Arena& arena) { arena.size = 0; }
+
+// Прави нов вектор. Ако е даден алокатор, данните се взимат от него (при липса на място - от хийпа)
+IntVector makeIntVector(const int capacity, Arena* arena = nullptr) {
     IntVector vector;
-    vector.data = utils::allocIntArray(capacity);
+    vector.data = arena ? (int*)utils::allocFromArena(*arena, sizeof(int) * capacity) : nullptr;
+    vector.arena = vector.data ? arena : nullptr;
+    vector.data = vector.data ? vector.data : utils::allocIntArray(capacity);
     vector.capacity = capacity;
     return vector;
 }
 
-CharVector makeCharVector(const int capacity) {
+CharVector makeCharVector(const int capacity, Arena* arena = nullptr) {
     CharVector vector;
-    vector.data = utils::allocCharArray(capacity);
+    vector.data = arena ? (char*)utils::allocFromArena(*arena, capacity) : nullptr;
+    vector.arena = vector.data ? arena : nullptr;
+    vector.data = vector.data ? vector.data : utils::allocCharArray(capacity);
+    vector.capacity = capacity;
+    return vector;
+}
+
+StringVector makeStringVector(const int capacity) {
+    StringVector vector;
+    vector.data = new std::string[capacity];
     vector.capacity = capacity;
     return vector;
 }
 
 void clearIntVector(IntVector& vector) {
-    utils::freeIntArray(vector.data);
+    if (vector.arena) {
+        utils::releaseToArena(*vector.arena, vector.data, sizeof(int) * vector.capacity);
+        vector.data = nullptr;
+        vector.arena = nullptr;
+    } else {
+        utils::freeIntArray(vector.data);
+    }
     vector.capacity = 0;
     vector.size = 0;
 }
 
 void clearCharVector(CharVector& vector) {
-    utils::freeCharArray(vector.data);
+    if (vector.arena) {
+        utils::releaseToArena(*vector.arena, vector.data, vector.capacity);
+        vector.data = nullptr;
+        vector.arena = nullptr;
+    } else {
+        utils::freeCharArray(vector.data);
+    }
+    vector.capacity = 0;
+    vector.size = 0;
+}
+
+void clearStringVector(StringVector& vector) {
+    delete[] vector.data;
+    vector.data = nullptr;
     vector.capacity = 0;
     vector.size = 0;
 }
@@ -145,6 +460,13 @@ void pushToCharVector(CharVector& vector, const char value) {
     vector.data[vector.size++] = value;
 }
 
+void pushToStringVector(StringVector& vector, const std::string& value) {
+    if (vector.size + 1 == vector.capacity) {
+        utils::reallocStringVector(vector, vector.capacity * 2);
+    }
+    vector.data[vector.size++] = value;
+}
+
 void popFromIntVector(IntVector& vector) {
     assert(vector.size > 0 && "Popping from empty IntVector");
     vector.data[--vector.size] = 0;
@@ -165,14 +487,29 @@ char getCharVectorBack(const CharVector& vector) {
     return vector.data[vector.size - 1];
 }
 
+Stack makeStack(const int capacity) {
+    Stack stack;
+    stack.data = new (std::nothrow) std::uint8_t[capacity > 0 ? capacity : 1]{};
+    assert(stack.data && "Failed to allocate memory");
+    stack.capacity = capacity;
+    return stack;
+}
+
+void freeStack(Stack& stack) {
+    delete[] stack.data;
+    stack.data = nullptr;
+    stack.capacity = 0;
+    stack.top = -1;
+}
+
 void pushToStack(Stack& stack, const int value) {
-    assert(stack.top < MAX_STACK_SIZE && "Stack capacity exceeded");
-    stack.data[++stack.top] = value;
+    assert(stack.top + 1 < stack.capacity && "Stack capacity exceeded");
+    stack.data[++stack.top] = (std::uint8_t)value;
 }
 
 void popFromStack(Stack& stack) {
     assert(stack.top >= 0 && "Popping from empty stack");
-    stack.data[stack.top--] = 0;
+    stack.top--;
 }
 
 int peekStack(const Stack& stack) {
@@ -182,32 +519,92 @@ int peekStack(const Stack& stack) {
 
 int getStackSize(const Stack& stack) { return stack.top + 1; }
 
-TruthTable makeTruthTable(const int capacity) {
+TruthTable makeTruthTable(const int capacity, const int cols, const int outputCount = 1) {
     TruthTable table;
-    table.data = utils::allocIntArray(capacity);
+    table.cols = cols;
+    table.outputCount = outputCount;
     table.capacity = capacity;
+    table.outputs = utils::allocWordArray(outputCount * ((capacity + 63) / 64));
+    const int inputCount = cols - outputCount;
+    table.impliedInputs = inputCount <= MAX_IMPLIED_INPUTS;
+    if (!table.impliedInputs) {
+        table.rowWords = (inputCount + 63) / 64;
+        table.data = utils::allocWordArray(capacity * table.rowWords);
+    }
     return table;
 }
 
 void freeTruthTable(TruthTable& table) {
-    utils::freeIntArray(table.data);
+    utils::freeWordArray(table.data);
+    utils::freeWordArray(table.outputs);
     table.capacity = 0;
-    table.size = 0;
     table.rows = 0;
     table.cols = 0;
+    table.outputCount = 1;
+    table.rowWords = 0;
+    table.impliedInputs = true;
+}
+
+// Записва изрично входовете на вече добавените редове (когато редовете спрат да следват пълната таблица)
+void materializeTruthTableInputs(TruthTable& table) {
+    const int inputCount = utils::getTruthTableInputCount(table);
+    table.rowWords = (inputCount + 63) / 64;
+    table.data = utils::allocWordArray(table.capacity * table.rowWords);
+    for (int i = 0; i < table.rows && table.rowWords > 0; i++) {
+        table.data[i * table.rowWords] = utils::getImpliedInputs(i, inputCount);
+    }
+    table.impliedInputs = false;
 }
 
-void pushToTruthTable(TruthTable& table, const int value) {
-    if (table.size + 1 == table.capacity) {
-        int* newData = utils::allocIntArray(table.capacity * 2);
-        for (int i = 0; i < table.size; i++) {
-            newData[i] = table.data[i];
+// Добавя ред в края на таблицата. Бит j от row е стойността в колона j, а последните outputCount
+// колони са изходите
+void pushToTruthTable(TruthTable& table, const std::uint64_t* row) {
+    const int inputCount = utils::getTruthTableInputCount(table);
+    if (table.rows == table.capacity) {
+        const int newCapacity = table.capacity > 0 ? table.capacity * 2 : 64;
+        const int outputWords = (table.capacity + 63) / 64;
+        const int newOutputWords = (newCapacity + 63) / 64;
+        std::uint64_t* newOutputs = utils::allocWordArray(table.outputCount * newOutputWords);
+        for (int k = 0; k < table.outputCount; k++) {
+            for (int w = 0; w < outputWords; w++) {
+                newOutputs[k * newOutputWords + w] = table.outputs[k * outputWords + w];
+            }
         }
-        utils::freeIntArray(table.data);
-        table.data = newData;
-        table.size++;
-        table.capacity = table.capacity * 2;
-        return;
+        utils::freeWordArray(table.outputs);
+        table.outputs = newOutputs;
+        if (!table.impliedInputs) {
+            std::uint64_t* newData = utils::allocWordArray(newCapacity * table.rowWords);
+            for (int i = 0; i < table.rows * table.rowWords; i++) {
+                newData[i] = table.data[i];
+            }
+            utils::freeWordArray(table.data);
+            table.data = newData;
+        }
+        table.capacity = newCapacity;
+    }
+
+    if (table.impliedInputs) {
+        const std::uint64_t inputMask = (1ULL << inputCount) - 1;
+        if (table.rows >= (1 << inputCount) ||
+            (row[0] & inputMask) != utils::getImpliedInputs(table.rows, inputCount)) {
+            materializeTruthTableInputs(table);
+        }
+    }
+    if (!table.impliedInputs) {
+        std::uint64_t* dest = table.data + table.rows * table.rowWords;
+        for (int w = 0; w < table.rowWords; w++) {
+            dest[w] = row[w];
+        }
+        // Изходите не са част от входовете
+        if (inputCount % 64 != 0) {
+            dest[table.rowWords - 1] &= (1ULL << (inputCount % 64)) - 1;
+        }
+    }
+    const int outputWords = (table.capacity + 63) / 64;
+    for (int k = 0; k < table.outputCount; k++) {
+        const int col = inputCount + k;
+        table.outputs[k * outputWords + table.rows / 64] |= ((row[col / 64] >> (col % 64)) & 1)
+                                                            << (table.rows % 64);
     }
-    table.data[table.size++] = value;
+    table.rows++;
 }
@@ -1,543 +1,413 @@
 // C++ system includes
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <sstream>
 #include <string>
 
 // Own includes
-#include "Utils.h"
-
-static constexpr auto MAX_CIRCUITS = 100;
-
-// Съдържа данните на интегрална схема
-struct IntegratedCircuit {
-    std::string name = "";
-    std::string expr = "";
-    CharVector tokenizedExpr;
-    CharVector arguments;
+#include "Circuit.h"
+
+// Настройки на сесията, зададени от командния ред
+struct SessionOptions {
+    int threadCount = 1;     // Брой нишки по подразбиране за ALL (-j N)
+    std::string scriptFile;  // Файл с команди (--script file, "-" е стандартният вход)
+    bool timing = false;     // Принтира времето за изпълнение на всяка команда (--time)
+    bool stats = false;      // Води статистика и я принтира в края на сесията (--stats)
 };
 
-// Съдържа аргументите за вход на интегрална схема
-struct CircuitInput {
-    std::string circuitName = "";  // Таргетната ис
-    IntVector args;
-};
-
-// Пази всички интегрални схеми в програмата
-struct CircuitStorage {
-    IntegratedCircuit* circuits = nullptr;
-    int size = 0;
-    int capacity = 0;
-};
-
-namespace utils {
-// Парсва име на файл
-std::string getFileName(std::istream& istream) {
-    std::string fileName;
-    std::getline(istream >> std::ws, fileName);
-    fileName = fileName.substr(fileName.find_first_of('\"') + 1, fileName.find_last_of('\"') - 1);
-    return fileName;
-}
-
-// Принтира данните за дадена ис
-void printCircuit(const IntegratedCircuit& circuit) {
-    const int argSize = circuit.arguments.size;
-    std::cout << circuit.name << "(";
-    for (int i = 0; i < argSize - 1; i++) {
-        std::cout << circuit.arguments.data[i] << ", ";
-    }
-    std::cout << circuit.arguments.data[argSize - 1] << ") " << circuit.expr << "\n";
-}
-
-// Проверява дали входовете на ис са същите като тези които се използват в логическия израз
-bool validateCircuit(const IntegratedCircuit& circuit) {
-    for (int i = 0; i < circuit.tokenizedExpr.size; i++) {
-        const auto token = circuit.tokenizedExpr.data[i];
-        if (token == '&' || token == '|' || token == '!' || token == '(' || token == ')') {
-            continue;
-        }
-        int j = 0;
-        for (; j < circuit.arguments.size; j++) {
-            const auto arg = circuit.arguments.data[j];
-            if (token == arg) {
-                break;
-            }
+// Парсва опциите от командния ред
+bool parseOptions(const int argc, char* argv[], SessionOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string option = argv[i];
+        if (option == "-j" && i + 1 < argc) {
+            options.threadCount = std::atoi(argv[++i]);
+        } else if (option == "--script" && i + 1 < argc) {
+            options.scriptFile = argv[++i];
+        } else if (option == "--time") {
+            options.timing = true;
+        } else if (option == "--stats") {
+            options.stats = true;
+        } else {
+            std::cerr << "Unknown option " << option << ".\nUsage: " << argv[0]
+                      << " [-j N] [--script file] [--time] [--stats]\n";
+            return false;
         }
-
-        if (j == circuit.arguments.size) {
-            std::cerr << "Found token {" << token << "} that is not valid operator or operand.\n";
+        if (options.threadCount < 1 || options.threadCount > utils::getMaxThreadCount()) {
+            std::cerr << "Thread count must be between 1 and " << utils::getMaxThreadCount()
+                      << ".\n";
             return false;
         }
     }
     return true;
 }
 
-// Замества входовете на логичиския израз с конкретни цифрови стойности взети от RUN команда или
-// генерирани автоматично
-CharVector getInputExpr(const IntegratedCircuit& circuit, const CircuitInput& input) {
-    CharVector inputExpr = makeCharVector(100);
-    for (int i = 0; i < circuit.tokenizedExpr.size; i++) {
-        const char token = circuit.tokenizedExpr.data[i];
-        pushToCharVector(inputExpr, token);
-    }
-
-    for (int i = 0; i < input.args.size; i++) {
-        for (int j = 0; j < circuit.tokenizedExpr.size; j++) {
-            if (circuit.tokenizedExpr.data[j] == circuit.arguments.data[i]) {
-                inputExpr.data[j] = (char)input.args.data[i] + '0';
-            }
-        }
-    }
-    return inputExpr;
+// Проверява дали командите се четат от стандартния вход (интерактивно или с --script -). Тогава
+// входните вектори на RUNFILE и SIM не могат да се четат от него, защото ще се смесят с командите
+bool readsCommandsFromStdin(const SessionOptions& options) {
+    return options.scriptFile.empty() || options.scriptFile == "-";
 }
 
-// Превръща входен израз на ис в токени
-void tokenizeExpression(CharVector& tokens, const std::string& expr) {
-    for (const auto ch : expr) {
-        if (ch == ' ' || ch == '\"') {
-            continue;
+// Изпълнява един ред с команда
+void runCommand(const std::string& line, CircuitStorage& storage, const SessionOptions& options,
+                Arena& arena, SessionStats& stats) {
+    const int defaultThreadCount = options.threadCount;
+    // Всичко, заделено в алокатора от предишната команда, вече не се използва
+    resetArena(arena);
+    std::istringstream istream(line);
+    std::string command;
+    istream >> command;
+    // Въвеждаме интегрална схема
+    if (command == "DEFINE") {
+        IntegratedCircuit circuit = parseIntegratedCircuit(istream, storage);
+        if (circuit.name.empty()) {
+            std::cerr << "Invalid expression entered. Skip DEFINE command.\n";
+            freeIntegratedCircuit(circuit);
+            return;
         }
-        pushToCharVector(tokens, ch);
-    }
-}
-
-// Връща предходността на логическите оператори
-int getPrecedence(const char op) {
-    switch (op) {
-    case '!':
-        return 3;
-    case '&':
-        return 2;
-    case '|':
-        return 1;
-    default:
-        std::cerr << "Unknown operator found: " << op << std::endl;
+        if (hasCircuit(storage, circuit.name)) {
+            std::cerr << "Integrated circuit with name " << circuit.name
+                      << " already exist. Skip DEFINE command.\n";
+        } else {
+            addCircuit(storage, circuit);
+        }
+        // Освобождаваме паметта
+        freeIntegratedCircuit(circuit);
     }
-    return -1;
-}
-
-// Превръща инфиксен запис на логически израз в постфиксен (използва Shunting Yard алгоритъма)
-CharVector convertInfixToPostfix(const CharVector& infixTokens) {
-    CharVector operators = makeCharVector(infixTokens.capacity);
-    CharVector postfixExpr = makeCharVector(infixTokens.capacity);
-
-    for (int i = 0; i < infixTokens.size; i++) {
-        const char token = infixTokens.data[i];
-        if (std::isdigit(token)) {
-            pushToCharVector(postfixExpr, token);
-        } else if (token == '(') {
-            pushToCharVector(operators, token);
-        } else if (token == ')') {
-            char op = getCharVectorBack(operators);
-            while (op != '(') {
-                popFromCharVector(operators);
-                pushToCharVector(postfixExpr, op);
-                assert(operators.size > 0 && "Mismatch in parenthesis found");
-                op = getCharVectorBack(operators);
-            }
-            popFromCharVector(operators);
-        } else if (token == '!' || token == '&' || token == '|') {
-            if (operators.size == 0) {
-                pushToCharVector(operators, token);
-                continue;
+    // Изпълняваме интегрална схема по име и входни параметри
+    else if (command == "RUN") {
+        CircuitInput input = parseRunCommand(istream, arena);
+        IntegratedCircuit* circuit =
+            input.circuitName.empty() ? nullptr : findCircuit(storage, input.circuitName);
+        if (input.circuitName.empty()) {
+            std::cerr << "Invalid input entered. Skip RUN command.\n";
+        } else if (!circuit) {
+            std::cerr << "Circuit with name " << input.circuitName
+                      << " does NOT exist.\nSkip RUN command.\n";
+        } else if (input.args.size != circuit->arguments.size) {
+            std::cerr << "Circuit " << circuit->name << " expects " << circuit->arguments.size
+                      << " arguments, got " << input.args.size << ".\nSkip RUN command.\n";
+        } else {
+            // При няколко изхода стойностите им се принтират на един ред. Буферът за изходите се
+            // взима от алокатора на командата (от кучата - само ако в него няма място)
+            const int outputCount = circuit->program.outputCount;
+            int* outputs = (int*)utils::allocFromArena(arena, sizeof(int) * outputCount);
+            const bool heapOutputs = !outputs;
+            outputs = heapOutputs ? utils::allocIntArray(outputCount) : outputs;
+            runCircuitCached(*circuit, input, outputs);
+            for (int i = 0; i < outputCount; i++) {
+                std::cout << outputs[i] << (i == outputCount - 1 ? '\n' : ' ');
             }
-            char op = getCharVectorBack(operators);
-            while (op != '(' && operators.size > 0 && getPrecedence(op) > getPrecedence(token)) {
-                popFromCharVector(operators);
-                pushToCharVector(postfixExpr, op);
-                if (operators.size > 0) {
-                    op = getCharVectorBack(operators);
-                }
+            if (heapOutputs) {
+                utils::freeIntArray(outputs);
             }
-            pushToCharVector(operators, token);
         }
+        // Освобождаваме паметта
+        freeCircuitInput(input);
     }
-
-    while (operators.size > 0) {
-        const char op = getCharVectorBack(operators);
-        pushToCharVector(postfixExpr, op);
-        popFromCharVector(operators);
-    }
-
-    // Освобождаваме паметта
-    clearCharVector(operators);
-    return postfixExpr;
-}
-
-// Изпълнява логически израз в постфиксен запис
-int evaluatePostfixExpr(const CharVector& postfixExpr) {
-    Stack exprStack;
-    for (int i = 0; i < postfixExpr.size; i++) {
-        const char token = postfixExpr.data[i];
-        if (std::isdigit(token)) {
-            pushToStack(exprStack, token - '0');
+    // Изпълняваме интегрална схема с всички входни вектори от файл
+    else if (command == "RUNFILE") {
+        std::string circuitName;
+        istream >> circuitName;
+        const std::string fileName = utils::getFileName(istream);
+        IntegratedCircuit* circuit = findCircuit(storage, circuitName);
+        if (!circuit) {
+            std::cerr << "Circuit with name " << circuitName
+                      << " does NOT exist.\nSkip RUNFILE command.\n";
+        } else if (fileName == "-" && readsCommandsFromStdin(options)) {
+            std::cerr << "Cannot read input vectors from standard input while commands are read "
+                         "from it.\nSkip RUNFILE command.\n";
         } else {
-            switch (token) {
-            case '!': {
-                assert(getStackSize(exprStack) >= 1);
-                const int operand = peekStack(exprStack);
-                popFromStack(exprStack);
-                pushToStack(exprStack, !operand);
-            } break;
-            case '&': {
-                assert(getStackSize(exprStack) >= 2);
-                const int operand2 = peekStack(exprStack);
-                popFromStack(exprStack);
-                const int operand1 = peekStack(exprStack);
-                popFromStack(exprStack);
-                pushToStack(exprStack, operand1 && operand2);
-            } break;
-            case '|': {
-                assert(getStackSize(exprStack) >= 2);
-                const int operand2 = peekStack(exprStack);
-                popFromStack(exprStack);
-                const int operand1 = peekStack(exprStack);
-                popFromStack(exprStack);
-                pushToStack(exprStack, operand1 || operand2);
-            } break;
-            default:
-                std::cerr << "Unknown token found: " << token << std::endl;
-                assert(false);
-            }
+            runFileCommand(*circuit, fileName);
         }
     }
-    assert(getStackSize(exprStack) == 1 && "Something is wrong");
-    return peekStack(exprStack);
-}
-}  // namespace utils
-
-// Прави нова ис
-IntegratedCircuit makeIntegratedCircuit() {
-    IntegratedCircuit circuit;
-    circuit.tokenizedExpr = makeCharVector(100);
-    circuit.arguments = makeCharVector(100);
-    return circuit;
-}
-
-// Освобождава паметта на дадената ис
-void freeIntegratedCircuit(IntegratedCircuit& circuit) {
-    clearCharVector(circuit.tokenizedExpr);
-    clearCharVector(circuit.arguments);
-    circuit.name = "";
-    circuit.expr = "";
-}
-
-// Прави нов вход за ис
-CircuitInput makeCircuitInput() {
-    CircuitInput input;
-    input.args = makeIntVector(100);
-    return input;
-}
-
-// Освобождава паметта на дадения вход
-void freeCircuitInput(CircuitInput& input) {
-    clearIntVector(input.args);
-    input.circuitName = "";
-}
-
-// Прави хранилище за ис
-CircuitStorage makeCircuitStorage(const int capacity) {
-    CircuitStorage storage;
-    storage.circuits = new IntegratedCircuit[capacity];
-    storage.capacity = capacity;
-    return storage;
-}
-
-// Освобождава паметта за всчки ис в хронилището
-void freeCircuitStorage(CircuitStorage& storage) {
-    for (int i = 0; i < storage.size; i++) {
-        freeIntegratedCircuit(storage.circuits[i]);
-    }
-    delete[] storage.circuits;
-    storage.circuits = nullptr;
-    storage.capacity = 0;
-    storage.size = 0;
-}
-
-// Прави дълбоко копие на дадена ис в хранилището
-void addCircuit(CircuitStorage& storage, const IntegratedCircuit& circuit) {
-    assert(storage.size < storage.capacity && "Circuit storage capacity exceeded");
-    // Правим нова ис
-    storage.circuits[storage.size] = makeIntegratedCircuit();
-    auto& storageCircuit = storage.circuits[storage.size];
-    // Копираме аргументите (входа) на схемата
-    for (int i = 0; i < circuit.arguments.size; i++) {
-        const char currArg = circuit.arguments.data[i];
-        pushToCharVector(storageCircuit.arguments, currArg);
-    }
-    // Копираме логическия израз
-    for (int i = 0; i < circuit.tokenizedExpr.size; i++) {
-        const char currToken = circuit.tokenizedExpr.data[i];
-        pushToCharVector(storageCircuit.tokenizedExpr, currToken);
-    }
-    // Копираме останалите данни
-    storageCircuit.name = circuit.name;
-    storageCircuit.expr = circuit.expr;
-    // Коригираме размера на хранилището
-    storage.size++;
-}
-
-// Принтираме всички налични ис
-void printStorage(const CircuitStorage& storage) {
-    for (int i = 0; i < storage.size; i++) {
-        utils::printCircuit(storage.circuits[i]);
-    }
-}
-
-// Търсим ис в хранилището и я връщаме при нейното наличие
-IntegratedCircuit* findCircuit(const CircuitStorage& storage, const std::string& name) {
-    for (int i = 0; i < storage.size; i++) {
-        if (storage.circuits[i].name == name) {
-            return &storage.circuits[i];
+    // Изпълняваме дадена интегрална схема с всички възможни входове
+    else if (command == "ALL") {
+        std::string circuitName;
+        istream >> circuitName;
+        // ALL name THREADS n задава броя нишки само за тази команда, а ALL name BDD принтира
+        // таблицата чрез диаграма на решенията (с незадължителна наредба на аргументите)
+        int threadCount = defaultThreadCount;
+        bool useBdd = false;
+        int orderKind = BDD_ORDER_NATURAL;
+        std::string option;
+        bool validOptions = true;
+        if (istream >> option) {
+            if (option == "THREADS") {
+                validOptions = (bool)(istream >> threadCount);
+            } else if (option == "BDD") {
+                useBdd = true;
+                std::string orderName;
+                if (istream >> option) {
+                    validOptions = option == "ORDER" && (bool)(istream >> orderName);
+                    if (orderName == "REVERSE") {
+                        orderKind = BDD_ORDER_REVERSE;
+                    } else if (orderName == "APPEARANCE") {
+                        orderKind = BDD_ORDER_APPEARANCE;
+                    } else if (orderName != "NATURAL") {
+                        validOptions = false;
+                    }
+                }
+            } else {
+                validOptions = false;
+            }
         }
-    }
-    return nullptr;
-}
-
-// Проверяваме дали ис се съдържа в хранилището
-bool hasCircuit(const CircuitStorage& storage, const std::string& name) {
-    for (int i = 0; i < storage.size; i++) {
-        if (storage.circuits[i].name == name) {
-            return true;
+        if (!validOptions) {
+            std::cerr << "Invalid option for ALL command. Usage: ALL name [THREADS n | BDD "
+                         "[ORDER NATURAL|REVERSE|APPEARANCE]]\n";
+            return;
+        }
+        if (threadCount < 1 || threadCount > utils::getMaxThreadCount()) {
+            std::cerr << "Thread count must be between 1 and " << utils::getMaxThreadCount()
+                      << ".\nSkip ALL command.\n";
+            return;
+        }
+        IntegratedCircuit* circuit = findCircuit(storage, circuitName);
+        if (!circuit) {
+            std::cerr << "Circuit with name " << circuitName
+                      << " does NOT exist.\nSkip ALL command.\n";
+        } else if (useBdd) {
+            runAllBddCommand(*circuit, orderKind);
+        } else {
+            runAllCommand(*circuit, threadCount);
         }
     }
-    return false;
-}
-
-// Парсваме ис от стандартния вход
-IntegratedCircuit parseIntegratedCircuit(std::istream& istream) {
-    IntegratedCircuit circuit = makeIntegratedCircuit();
-
-    std::getline(istream >> std::ws, circuit.name, '(');
-    char arg;
-    while (istream.get(arg) && arg != ')') {
-        if (arg == ' ' || arg == ',') {
-            continue;
+    // Изпълняваме ис със случайни входни вектори
+    else if (command == "RANDOM") {
+        std::string circuitName;
+        long long vectorCount = 0;
+        istream >> circuitName >> vectorCount;
+        // RANDOM name N [seed] [SENSITIVITY] [DUMP] - DUMP принтира векторите във формата на ALL
+        std::uint64_t seed = 1;
+        bool sensitivity = false;
+        bool dump = false;
+        bool validOptions = vectorCount > 0;
+        std::string option;
+        for (int i = 0; validOptions && istream >> option; i++) {
+            if (option == "SENSITIVITY") {
+                sensitivity = true;
+            } else if (option == "DUMP") {
+                dump = true;
+            } else if (i == 0 && std::isdigit((unsigned char)option[0])) {
+                seed = std::strtoull(option.c_str(), nullptr, 10);
+            } else {
+                validOptions = false;
+            }
+        }
+        if (!validOptions) {
+            std::cerr << "Invalid RANDOM command. Usage: RANDOM name N [seed] [SENSITIVITY] "
+                         "[DUMP]\n";
+            return;
+        }
+        const IntegratedCircuit* circuit = findCircuit(storage, circuitName);
+        if (!circuit) {
+            std::cerr << "Circuit with name " << circuitName
+                      << " does NOT exist.\nSkip RANDOM command.\n";
+        } else {
+            runRandomCommand(*circuit, (std::uint64_t)vectorCount, seed, sensitivity, dump,
+                             defaultThreadCount);
         }
-        pushToCharVector(circuit.arguments, arg);
     }
-
-    std::string expression;
-    std::getline(istream, expression);
-    circuit.expr = expression.substr(expression.find_first_of("\""));
-
-    utils::tokenizeExpression(circuit.tokenizedExpr, circuit.expr);
-    if (!utils::validateCircuit(circuit)) {
-        freeIntegratedCircuit(circuit);
+    // Компилираме ис до нативен код
+    else if (command == "COMPILE") {
+        std::string circuitName;
+        istream >> circuitName;
+        IntegratedCircuit* circuit = findCircuit(storage, circuitName);
+        if (!circuit) {
+            std::cerr << "Circuit with name " << circuitName
+                      << " does NOT exist.\nSkip COMPILE command.\n";
+        } else {
+            runCompileCommand(*circuit);
+        }
     }
-
-    return circuit;
-}
-
-// Парсваме вход за ис
-CircuitInput parseRunCommand(std::istream& istream) {
-    CircuitInput input = makeCircuitInput();
-    std::getline(istream >> std::ws, input.circuitName, '(');
-
-    char arg;
-    while (istream.get(arg) && arg != ')') {
-        if (arg == ' ' || arg == ',') {
-            continue;
+    // Симулираме последователна ис за даден брой тактове с входни потоци от файл
+    else if (command == "SIM") {
+        std::string circuitName;
+        std::int64_t cycles = 0;
+        istream >> circuitName >> cycles;
+        const std::string fileName = utils::getFileName(istream);
+        if (cycles < 1 || fileName.empty()) {
+            std::cerr << "Invalid SIM command. Usage: SIM name cycles \"file\"\n";
+            return;
+        }
+        if (fileName == "-" && readsCommandsFromStdin(options)) {
+            std::cerr << "Cannot read input streams from standard input while commands are read "
+                         "from it.\nSkip SIM command.\n";
+            return;
         }
-        if (std::isdigit(arg)) {
-            pushToIntVector(input.args, arg - '0');
+        const IntegratedCircuit* circuit = findCircuit(storage, circuitName);
+        if (!circuit) {
+            std::cerr << "Circuit with name " << circuitName
+                      << " does NOT exist.\nSkip SIM command.\n";
         } else {
-            assert(false && "Invalid argument parsed for RUN command");
+            runSimCommand(*circuit, cycles, fileName, defaultThreadCount);
         }
     }
-
-    return input;
-}
-
-// Изпълняваме ис с дадения вход
-int runCircuit(const IntegratedCircuit& circuit, const CircuitInput& input) {
-    CharVector inputInfixExpr = utils::getInputExpr(circuit, input);
-    CharVector postfixExpr = utils::convertInfixToPostfix(inputInfixExpr);
-    const int result = utils::evaluatePostfixExpr(postfixExpr);
-    // Освобождаваме паметта
-    clearCharVector(inputInfixExpr);
-    clearCharVector(postfixExpr);
-    return result;
-}
-
-// Принтираме всички възможни комбинации за вход на ис заедно с резултата
-void printAll(const IntegratedCircuit& circuit, CircuitInput& input, const int currIdx) {
-    if (currIdx == input.args.size) {
-        for (int i = 0; i < input.args.size - 1; i++) {
-            std::cout << input.args.data[i] << " | ";
+    // Проверяваме дали две ис са еквивалентни
+    else if (command == "EQUIV") {
+        std::string firstName;
+        std::string secondName;
+        istream >> firstName >> secondName;
+        const IntegratedCircuit* first = findCircuit(storage, firstName);
+        const IntegratedCircuit* second = findCircuit(storage, secondName);
+        if (!first || !second) {
+            std::cerr << "Circuit with name " << (first ? secondName : firstName)
+                      << " does NOT exist.\nSkip EQUIV command.\n";
+        } else {
+            runEquivCommand(*first, *second);
         }
-        std::cout << input.args.data[input.args.size - 1] << " | res: ";
-        const int res = runCircuit(circuit, input);
-        std::cout << res << std::endl;
-        return;
     }
-
-    for (int i = 0; i <= 1; i++) {
-        input.args.data[currIdx] = i;
-        printAll(circuit, input, currIdx + 1);
+    // Проверяваме дали ис има вход с резултат 1 и броим тези входове
+    else if (command == "SAT") {
+        std::string circuitName;
+        istream >> circuitName;
+        const IntegratedCircuit* circuit = findCircuit(storage, circuitName);
+        if (!circuit) {
+            std::cerr << "Circuit with name " << circuitName
+                      << " does NOT exist.\nSkip SAT command.\n";
+        } else {
+            runSatCommand(*circuit);
+        }
     }
-}
-
-// Изпълнява командата ALL
-void runAllCommand(IntegratedCircuit& circuit) {
-    CircuitInput input = makeCircuitInput();
-    input.circuitName = circuit.name;
-    for (int i = 0; i < circuit.arguments.size; i++) {
-        pushToIntVector(input.args, 0);
+    // Записваме всички ис в двоичен файл с библиотека
+    else if (command == "SAVE") {
+        const std::string fileName = utils::getFileName(istream);
+        if (saveCircuitLibrary(storage, fileName)) {
+            std::cout << "Saved " << storage.size << " circuits to " << fileName << '\n';
+        }
     }
-    std::cout << "Execute " << circuit.name << " " << circuit.expr << std::endl;
-    printAll(circuit, input, 0);
-    // Освобождаваме паметта
-    freeCircuitInput(input);
-}
-
-// Парсва таблица на истинност от даден файл
-TruthTable parseTruthTable(const std::string& file) {
-    TruthTable table = makeTruthTable(100);
-    std::ifstream inputFile(file, std::ios::in);
-    // assert(inputFile.is_open() && "Input file is not open");
-    if (!inputFile.is_open()) {
-        std::cerr << "Failed to parse truth table for file with name " << file << ".\n";
-        std::cerr
-            << "Maybe the file name is wrong or the file is missing from the working directory.\n";
+    // Зареждаме ис от двоичен файл с библиотека
+    else if (command == "LOAD") {
+        loadCircuitLibrary(storage, utils::getFileName(istream));
+    }
+    // Изчисляваме интегрална схема по дадена таблица на истинност от файл
+    else if (command == "FIND") {
+        const std::string fileName = utils::getFileName(istream);
+        // FIND "file" MIN минимизира намерената функция, а OUTPUTS k задава, че последните k колони
+        // на таблицата са изходи (функциите им се принтират разделени със запетаи)
+        bool minimize = false;
+        int outputCount = 1;
+        std::string option;
+        bool validOptions = true;
+        while (validOptions && istream >> option) {
+            if (option == "MIN") {
+                minimize = true;
+            } else if (option == "OUTPUTS") {
+                validOptions = (bool)(istream >> outputCount) && outputCount >= 1;
+            } else {
+                validOptions = false;
+            }
+        }
+        if (!validOptions) {
+            std::cerr
+                << "Invalid option for FIND command. Usage: FIND \"file\" [MIN] [OUTPUTS k]\n";
+            return;
+        }
+        TruthTable table = parseTruthTable(fileName, outputCount);
+        if (!table.outputs) {
+            std::cerr << "Skip FIND command.\n";
+            return;
+        }
+        utils::printTruthTable(table);
+        std::string logicFunc;
+        for (int output = 0; output < outputCount; output++) {
+            logicFunc += output > 0 ? ", " : "";
+            logicFunc +=
+                minimize ? runFindMinCommand(table, output) : runFindCommand(table, output);
+        }
+        std::cout << logicFunc << '\n';
+        // Освобождаваме паметта
         freeTruthTable(table);
-        return table;
     }
-
-    std::string line;
-    while (std::getline(inputFile, line)) {
-        std::istringstream istream(line);
-        int entry = -1;
-        int colCounter = 0;
-        while (istream >> entry) {
-            colCounter++;
-            pushToTruthTable(table, entry);
+    // Принтираме всички налични интеглани схеми
+    else if (command == "PRINT") {
+        printStorage(storage);
+    }
+    // Принтираме статистиката на сесията (STATS RESET я нулира). Първата команда STATS включва
+    // воденето на статистика, ако сесията не е стартирана с --stats
+    else if (command == "STATS") {
+        std::string option;
+        if (istream >> option) {
+            if (option != "RESET") {
+                std::cerr << "Invalid option for STATS command. Usage: STATS [RESET]\n";
+                return;
+            }
+            resetSessionStats(stats);
+            stats.enabled = true;
+            std::cout << "Statistics reset\n";
+        } else if (!stats.enabled) {
+            // Броячите на кешовете са се увеличавали и досега
+            resetSessionStats(stats);
+            stats.enabled = true;
+            std::cout << "Statistics enabled\n";
+        } else {
+            printSessionStats(stats, std::cout);
         }
-        table.rows++;
-        table.cols = colCounter;
     }
-    return table;
 }
 
-// Прави синтез по 1 за дадения вход
-std::string synthLogicFuncByOne(const int* input, const int inputSize) {
-    std::string result = "(";
-    for (int i = 0; i < inputSize; i++) {
-        const char arg = i + 49 + '0';
-        if (input[i] == 0) {
-            result.append("!");
-        }
-        result += arg;
-        if (i != inputSize - 1) {
-            result += " & ";
-        }
+int main(int argc, char* argv[]) {
+    SessionOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
     }
-    result += ")";
-    return result;
-}
 
-// Изпълнява командата FIND
-std::string runFindCommand(const TruthTable& table) {
-    std::string logicFunc = "\"";
-    for (int i = 0; i < table.rows; i++) {
-        // Вземаме резултата на ф-та за настоящия ред
-        const int res = table.data[i * table.cols + table.cols - 1];
-        if (1 == res) {
-            // Копираме входовете на ф-ята
-            int* currInput = utils::allocIntArray(table.cols - 1);
-            for (int k = 0; k < table.cols - 1; k++) {
-                currInput[k] = table.data[i * table.cols + k];
+    // Без --script сесията е интерактивна - с покана за всяка команда. Иначе командите се четат от
+    // файл (или от стандартния вход) без покани, а изходът се буферира на големи блокове
+    const bool interactive = options.scriptFile.empty();
+    std::ifstream scriptFile;
+    if (!interactive) {
+        std::setvbuf(stdout, nullptr, _IOFBF, IO_BUFFER_SIZE);
+        if (options.scriptFile != "-") {
+            scriptFile.open(options.scriptFile);
+            if (!scriptFile.is_open()) {
+                std::cerr << "Failed to open script file with name " << options.scriptFile << ".\n";
+                return 1;
             }
-            // Синтезираме по 1
-            logicFunc += synthLogicFuncByOne(currInput, table.cols - 1);
-            logicFunc += " | ";
-            // Освобождаваме паметта
-            utils::freeIntArray(currInput);
         }
     }
+    std::istream& commands = scriptFile.is_open() ? scriptFile : std::cin;
 
-    if (!logicFunc.empty()) {
-        logicFunc = logicFunc.substr(0, logicFunc.find_last_of(')') + 1);
-        logicFunc.append("\"");
+    if (interactive) {
+        std::cout << "Console simulator of Digital Integrated Circuits\nEnter command: ";
     }
-    return logicFunc;
-}
-
-int main() {
-    std::cout << "Console simulator of Digital Integrated Circuits\nEnter command: ";
-    CircuitStorage storage = makeCircuitStorage(MAX_CIRCUITS);
+    CircuitStorage storage = makeCircuitStorage(INITIAL_CIRCUITS_CAPACITY);
+    Arena commandArena = makeArena(COMMAND_ARENA_SIZE);
+    // Статистиката е голяма (хистограма за всеки вид команда), затова не е на стека
+    SessionStats* stats = new SessionStats;
+    stats->enabled = options.stats;
 
-    std::string input;
-    while (std::getline(std::cin, input) && input != "EXIT") {
-        std::istringstream istream(input);
-        std::string command;
-        istream >> command;
-        // Въвеждаме интегрална схема
-        if (command == "DEFINE") {
-            IntegratedCircuit circuit = parseIntegratedCircuit(istream);
-            if (circuit.name.empty()) {
-                std::cerr << "Invalid expression entered. Skip DEFINE command.\nEnter command: ";
-                freeIntegratedCircuit(circuit);
-                continue;
-            }
-            if (hasCircuit(storage, circuit.name)) {
-                std::cerr << "Integrated circuit with name " << circuit.name
-                          << " already exist. Skip DEFINE command." << std::endl;
-            } else {
-                addCircuit(storage, circuit);
-            }
-            // Освобождаваме паметта
-            freeIntegratedCircuit(circuit);
-        }
-        // Изпълняваме интегрална схема по име и входни параметри
-        else if (command == "RUN") {
-            CircuitInput input = parseRunCommand(istream);
-            IntegratedCircuit* circuit = findCircuit(storage, input.circuitName);
-            if (!circuit) {
-                std::cerr << "Circuit with name " << input.circuitName
-                          << " does NOT exist.\nSkip RUN command." << std::endl;
-            } else {
-                const int res = runCircuit(*circuit, input);
-                std::cout << res << std::endl;
-            }
-            // Освобождаваме паметта
-            freeCircuitInput(input);
-        }
-        // Изпълняваме дадена интегрална схема с всички възможни входове
-        else if (command == "ALL") {
-            std::string circuitName;
-            istream >> circuitName;
-            IntegratedCircuit* circuit = findCircuit(storage, circuitName);
-            if (!circuit) {
-                std::cerr << "Circuit with name " << circuitName
-                          << " does NOT exist.\nSkip ALL command." << std::endl;
-            } else {
-                runAllCommand(*circuit);
-            }
+    std::string line;
+    while (std::getline(commands, line) && line != "EXIT") {
+        const auto start = std::chrono::steady_clock::now();
+        const std::uint64_t bytesBefore = allocatedBytes.load(std::memory_order_relaxed);
+        // Командата STATS може да включи статистиката - самата тя се записва едва след това
+        const bool recording = stats->enabled;
+        runCommand(line, storage, options, commandArena, *stats);
+        const std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+        if (options.timing) {
+            std::cerr << "Command took " << elapsed.count() / 1e6 << " ms\n";
         }
-        // Изчисляваме интегрална схема по дадена таблица на истинност от файл
-        else if (command == "FIND") {
-            const std::string fileName = utils::getFileName(istream);
-            TruthTable table = parseTruthTable(fileName);
-            if (!table.data) {
-                std::cerr << "Skip FIND command.\nEnter command: ";
-                continue;
-            }
-            utils::printTruthTable(table);
-            const std::string logicFunc = runFindCommand(table);
-            std::cout << logicFunc << std::endl;
-            // Освобождаваме паметта
-            freeTruthTable(table);
+        if (recording) {
+            recordCommand(*stats, getCommandKind(line), (std::uint64_t)elapsed.count(),
+                          allocatedBytes.load(std::memory_order_relaxed) - bytesBefore);
         }
-        // Принтираме всички налични интеглани схеми
-        else if (command == "PRINT") {
-            printStorage(storage);
+        if (interactive) {
+            std::cout << "Enter command: ";
         }
-        std::cout << "Enter command: ";
     }
 
     // Програмата би трябвало да leak-ва само служебни байтове
     // всички CharVector-и IntVector-и и структури които ги съдържат се почистват правилно
+    if (options.stats) {
+        printSessionStats(*stats, std::cerr);
+    }
+
     freeCircuitStorage(storage);
+    freeArena(commandArena);
+    delete stats;
 
     return 0;
 }